@@ -23,6 +23,7 @@ void DOutput_Save(DOutputState_t* state);
 void DOutput_SetRelay(uint8_t channel, bool state);
 void DOutput_GetState(DOutputState_t* state);
 void DOutput_Process(DOutputState_t* state);
+void DOutput_Update(uint8_t channel);
 
 #ifdef __cplusplus
 }
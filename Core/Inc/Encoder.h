@@ -4,6 +4,7 @@
 #include "stdint.h" 
 #include "main.h"
 #include "stdbool.h"
+#include "FixedPoint.h"
 typedef struct {
     uint16_t Status_Word;                           // REG_ENCODER_STATUS_WORD (0x0040)
     uint16_t volatile Encoder_Count;                // REG_ENCODER_COUNT (0x0041) - Quantity of pulses
@@ -43,6 +44,12 @@ void Encoder_ResetWireLength(Encoder_t* encoder);
 void Encoder_SetWireLength(Encoder_t* encoder, float length_mm);
 float Encoder_GetCurrentRadius(void);
 
+// Speed feedback (gọi Encoder_UpdateSpeed 1 lần mỗi chu kỳ điều khiển)
+void Encoder_UpdateSpeed(void);
+void Encoder_HandleTimerInterrupt(void);    // TIM2 update/CC3: mở rộng trục thời gian capture
+bool Encoder_HasSpeedFeedback(uint8_t motor_id);
+q16_t Encoder_GetSpeedRpm(uint8_t motor_id);
+
 // Diagnostic functions
 int32_t Encoder_GetTotalTicks(void);
 uint32_t Encoder_GetNoiseRejectCount(void);
@@ -0,0 +1,136 @@
+#ifndef __FIXED_POINT_H__
+#define __FIXED_POINT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// SỐ THỰC DẤU PHẨY TĨNH Q16.16
+// ═══════════════════════════════════════════════════════════════════════════════
+// - STM32F103 (Cortex-M3) không có FPU: mỗi phép float là 1 lời gọi soft-float
+//   (__aeabi_fmul/fdiv...) vài chục tới vài trăm cycle
+// - q16_t = int32 với 16 bit phần lẻ: cộng/trừ là ADD, nhân là SMULL 64 bit + dịch
+// - Các phép đều bão hòa ở Q16_MIN/Q16_MAX (±32768) thay vì tràn vòng
+// - dt (giây) dùng Q0.32 không dấu: 1 ms = 4294967, sai số lượng tử < 1 ppm
+// ═══════════════════════════════════════════════════════════════════════════════
+
+typedef int32_t q16_t;
+
+#define Q16_SHIFT       16
+#define Q16_ONE         ((q16_t)0x00010000)
+#define Q16_MAX         ((q16_t)0x7FFFFFFF)
+#define Q16_MIN         ((q16_t)(-0x7FFFFFFF - 1))
+#define Q16_FROM_INT(x) ((q16_t)((x) * Q16_ONE))     // Hằng số lúc biên dịch, không bão hòa
+
+/**
+ * @brief Ép kết quả 64 bit về q16_t (bão hòa)
+ */
+static inline q16_t q16Saturate(int64_t value)
+{
+    if (value > Q16_MAX) {
+        return Q16_MAX;
+    }
+    if (value < Q16_MIN) {
+        return Q16_MIN;
+    }
+    return (q16_t)value;
+}
+
+static inline q16_t q16FromInt(int32_t value)
+{
+    return q16Saturate((int64_t)value * Q16_ONE);
+}
+
+/**
+ * @brief Phần nguyên, làm tròn về 0 như ép kiểu float -> int
+ */
+static inline int32_t q16ToInt(q16_t value)
+{
+    return (int32_t)((value >= 0) ? (value >> Q16_SHIFT) : -((-(int64_t)value) >> Q16_SHIFT));
+}
+
+static inline q16_t q16Add(q16_t a, q16_t b)
+{
+    return q16Saturate((int64_t)a + b);
+}
+
+static inline q16_t q16Sub(q16_t a, q16_t b)
+{
+    return q16Saturate((int64_t)a - b);
+}
+
+static inline q16_t q16Mul(q16_t a, q16_t b)
+{
+    return q16Saturate(((int64_t)a * b) >> Q16_SHIFT);
+}
+
+/**
+ * @brief a × dt với dt (giây) ở Q0.32 - không tràn khi dt < 1 s
+ */
+static inline q16_t q16MulQ32(q16_t a, uint32_t dtQ32)
+{
+    return (q16_t)(((int64_t)a * dtQ32) >> 32);
+}
+
+static inline q16_t q16Abs(q16_t value)
+{
+    return (value >= 0) ? value : q16Saturate(-(int64_t)value);
+}
+
+static inline q16_t q16Clamp(q16_t value, q16_t min, q16_t max)
+{
+    if (value > max) {
+        return max;
+    }
+    if (value < min) {
+        return min;
+    }
+    return value;
+}
+
+/**
+ * @brief value × scale về int16 (bão hòa) - cho thanh ghi/telemetry x10, x100
+ */
+static inline int16_t q16ToInt16Scaled(q16_t value, int32_t scale)
+{
+    int64_t scaled = ((int64_t)value * scale) / Q16_ONE;
+    if (scaled > 32767) {
+        return 32767;
+    }
+    if (scaled < -32768) {
+        return -32768;
+    }
+    return (int16_t)scaled;
+}
+
+/**
+ * @brief Căn bậc hai nguyên của số 64 bit không dấu (floor)
+ * @note  Căn của giá trị Q32.32 là Q16.16 - dùng khi lập hồ sơ chuyển động, không gọi mỗi tick
+ */
+static inline uint32_t isqrt64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __MODBUS_CRC_H__
+#define __MODBUS_CRC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// CRC-16/MODBUS (poly 0xA001 reflected, init 0xFFFF) - TABLE DRIVEN
+// ═══════════════════════════════════════════════════════════════════════════════
+// - Bảng 256 entry (512 byte flash): 1 lần tra bảng / byte thay cho 8 vòng lặp bit
+// - Incremental: modbusCRCUpdate() cập nhật CRC từng byte, ghép được vào vòng lặp khác
+// - Chạy CRC qua cả 2 byte CRC của frame (low byte trước) cho kết quả 0
+//   => không cần tách 2 byte CRC ra để so, chỉ so với MODBUS_CRC_RESIDUE
+// - RX dùng DMA nên không có ngắt từng byte: CRC vẫn là O(n) ở cuối frame, chạy trong
+//   vòng copy frame ra khỏi buffer DMA (ISR T3.5) nên không thêm lần duyệt nào
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define MODBUS_CRC_INIT         0xFFFF
+#define MODBUS_CRC_RESIDUE      0x0000
+
+extern const uint16_t modbusCRCTable[256];
+
+/**
+ * @brief Cập nhật CRC với 1 byte (dùng được trong ISR)
+ */
+static inline uint16_t modbusCRCUpdate(uint16_t crc, uint8_t byte)
+{
+    return (crc >> 8) ^ modbusCRCTable[(uint8_t)(crc ^ byte)];
+}
+
+/**
+ * @brief Tiếp tục CRC qua 1 đoạn buffer (ghép với phần đã tính dần trước đó)
+ */
+uint16_t modbusCRCBlock(uint16_t crc, const uint8_t *buf, int len);
+
+uint16_t calcCRC(uint8_t *buf, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
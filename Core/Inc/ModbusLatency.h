@@ -0,0 +1,37 @@
+#ifndef __MODBUS_LATENCY_H__
+#define __MODBUS_LATENCY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// MODBUS LATENCY HISTOGRAM (DWT cycle counter)
+// ═══════════════════════════════════════════════════════════════════════════════
+// Mốc thời gian của 1 transaction:
+//   t0 = cuối frame RX (T3.5, dispatchFrame trong ISR TIM4)
+//   t1 = UartTask bắt đầu processModbusFrame
+//   t2 = response bắt đầu truyền DMA
+//   t3 = byte cuối ra khỏi dây (USART TC, HAL_UART_TxCpltCallback)
+// Tổng t3 - t0 được đưa vào histogram theo function code (và tổng mọi FC).
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define LATENCY_BUCKET_COUNT    7       // Giới hạn trên (µs): 250, 500, 1000, 2000, 5000, 10000, ∞
+#define LATENCY_FC_SLOTS        13      // Slot 0 = mọi FC, 1..12 = từng FC được hỗ trợ
+
+void ModbusLatency_Init(void);
+void ModbusLatency_EnableCycleCounter(void);    // Dùng chung cho mọi module đọc DWT->CYCCNT
+void ModbusLatency_MarkRxEnd(void);                 // ISR
+void ModbusLatency_MarkProcessStart(void);
+void ModbusLatency_MarkTxStart(uint8_t funcCode);
+void ModbusLatency_MarkTxDone(void);                // ISR
+void ModbusLatency_Reset(void);
+void ModbusLatency_UpdateRegisters(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,7 +14,65 @@
 #define REG_SYSTEM_STATUS          0x0107
 #define REG_SYSTEM_ERROR           0x0108
 #define REG_RESET_ERROR_COMMAND    0x0109
-
+#define REG_SYNC_ARM               0x010A
+#define REG_SYNC_TRIGGER           0x010B
+#define REG_CONFIG_REVERT_TIMEOUT  0x010E  // Giây; 0 = không tự quay lại cấu hình UART cũ
+#define REG_CONFIG_STATUS          0x010F
+
+// Fast Poll Block (Base Address: 0x00D0 map, 0x00F0 data)
+// Map[i] = địa chỉ nguồn của Fast_Poll[i] (0xFFFF = không dùng)
+#define REG_FAST_POLL_MAP_START    0x00D0
+#define REG_FAST_POLL_START        0x00F0
+#define FAST_POLL_COUNT            16
+#define FAST_POLL_UNUSED           0xFFFF
+
+// Communication Diagnostic Registers (Base Address: 0x0110)
+#define REG_COMM_FRAME_COUNT       0x0110
+#define REG_COMM_LAST_FRAME_BYTES  0x0111
+#define REG_COMM_MAX_FRAME_BYTES   0x0112
+#define REG_COMM_OVERRUN_COUNT     0x0113
+#define REG_COMM_UART_ERROR_COUNT  0x0114
+#define REG_COMM_CRC_ERROR_COUNT   0x0115
+#define REG_COMM_T15_US            0x0116
+#define REG_COMM_T35_US            0x0117
+#define REG_COMM_T15_VIOLATION_COUNT 0x0118
+#define REG_COMM_BAUDRATE_X100     0x0119  // Baud thực tế trên dây (theo BRR) / 100
+#define REG_RS485_PRE_GUARD_US     0x011A  // Bật DE -> bắt đầu TX
+#define REG_RS485_POST_GUARD_US    0x011B  // TC -> nhả DE
+#define REG_RS485_DE_MODE          0x011C
+
+// Bulk Telemetry Registers (Base Address: 0x0120) - dữ liệu đọc bằng FC 0x41
+#define REG_TELEMETRY_MOTOR        0x0120  // 0 = tắt, 1 = Motor 1, 2 = Motor 2
+#define REG_TELEMETRY_DECIMATION   0x0121  // Ghi 1 sample mỗi N chu kỳ điều khiển
+#define REG_TELEMETRY_PENDING      0x0122  // Sample đang chờ trong ring buffer
+#define REG_TELEMETRY_DROPPED      0x0123  // Sample bị bỏ vì ring đầy (đếm vòng 16 bit)
+
+// Control Loop Registers (0x0124) - nhịp MotorTask từ TIM3 CC4
+#define REG_CONTROL_RATE_HZ        0x0124  // Tần số vòng điều khiển (1000-5000 Hz)
+#define REG_CONTROL_DT_US          0x0125  // dt đo được của chu kỳ gần nhất
+#define REG_CONTROL_JITTER_US      0x0126  // Max |dt - 1/Rate| từ lần xóa gần nhất
+#define REG_CONTROL_OVERRUN_COUNT  0x0127  // Số tick bị bỏ vì chu kỳ trước chưa xong, ghi 0 để xóa
+#define REG_PID_CYCLES             0x0128  // Số CPU cycle của lần PID_Compute* gần nhất
+#define REG_PID_CYCLES_MAX         0x0129  // Max từ lần xóa gần nhất, ghi 0 để xóa
+
+// Speed Feedback Registers (0x012A) - tốc độ đo từ encoder cho PID tốc độ
+#define REG_SPEED_M1_RPM_X10       0x012A  // Tốc độ spool Motor 1 (RPM ×10, âm khi REVERSE)
+#define REG_SPEED_RATED_RPM        0x012B  // RPM ứng với Command_Speed = 100%
+
+// Motion Profile Register (0x012C) - hồ sơ chuyển động của Position mode
+#define REG_PROFILE_JERK_MS        0x012C  // Thời gian tăng/giảm gia tốc S-curve (ms), 0 = hình thang
+
+// Modbus Latency Histogram Registers (Base Address: 0x0130)
+#define REG_LATENCY_FC_SELECT      0x0130  // FC hiển thị ở 0x0132-0x013F (0 = mọi FC)
+#define REG_LATENCY_RESET          0x0131  // Ghi 1 để xóa thống kê
+#define REG_LATENCY_COUNT          0x0132
+#define REG_LATENCY_MIN_US         0x0133
+#define REG_LATENCY_MAX_US         0x0134
+#define REG_LATENCY_P99_US         0x0135
+#define REG_LATENCY_LAST_WAKEUP_US 0x0136  // Cuối RX -> UartTask xử lý
+#define REG_LATENCY_LAST_PROCESS_US 0x0137 // Xử lý frame -> bắt đầu TX
+#define REG_LATENCY_LAST_TX_US     0x0138  // Bắt đầu TX -> byte cuối ra dây
+#define REG_LATENCY_BUCKET_START   0x0139  // 7 bucket: <250, <500, <1000, <2000, <5000, <10000, >=10000 µs
 
 // Motor 1 Registers (Base Address: 0x0010)
 #define REG_M1_CONTROL_MODE        0x0000
@@ -81,8 +139,36 @@
 #define REG_ENCODER_CALIB_CURRENT_LENGTH_CM     0x004B
 #define REG_ENCODER_CALIB_ORIGIN_STATUS         0x004C
 #define REG_ENCODER_UNROLLED_WIRE_LENGTH_CM     0x004D
+
+// Snapshot cycle counter (cùng block với process image để master đọc 1 lần)
+#define REG_SNAPSHOT_CYCLE_LO                   0x004E
+#define REG_SNAPSHOT_CYCLE_HI                   0x004F
 // Total register count
-#define TOTAL_HOLDING_REG_COUNT    0x004E  // Total number of registers
+#define TOTAL_HOLDING_REG_COUNT    0x0050  // Total number of registers
+
+// Số thanh ghi của mỗi block (dùng cho dirty bitmap)
+#define SYSTEM_REG_BLOCK_COUNT     0x000A  // 0x0100-0x0109
+#define MOTOR_REG_BLOCK_COUNT      0x0010  // 0x0000-0x000F / 0x0010-0x001F
+#define ENCODER_REG_BLOCK_COUNT    0x000E  // 0x0040-0x004D
+
+// Config_Baudrate codes
+#define BAUDRATE_CODE_AUTO         0       // Đo start bit của master và tự khóa
+#define BAUDRATE_CODE_MAX          8       // 1=9600 ... 5=115200, 6=230400, 7=460800, 8=921600
+
+// Config_Parity / Config_Stop_Bit values
+#define PARITY_NONE                0
+#define PARITY_EVEN                1
+#define PARITY_ODD                 2
+
+// RS485_DE_Mode values
+#define RS485_DE_DISABLED          0       // Transceiver tự đảo chiều, chân DE giữ mức thấp
+#define RS485_DE_ACTIVE_HIGH       1
+#define RS485_DE_ACTIVE_LOW        2
+
+// Config_Status values
+#define SERIAL_CONFIG_APPLIED      0       // Cấu hình hiện tại đã được xác nhận
+#define SERIAL_CONFIG_TRIAL        1       // Đang chờ frame hợp lệ ở cấu hình mới
+#define SERIAL_CONFIG_REVERTED     2       // Hết timeout, đã quay lại cấu hình cũ
 
 // Default Values for System Registers
 #define DEFAULT_DEVICE_ID          3
@@ -96,6 +182,19 @@
 #define DEFAULT_SYSTEM_ERROR       0
 #define DEFAULT_RESET_ERROR_COMMAND 0
 
+// Control loop rate
+#define DEFAULT_CONTROL_RATE_HZ    1000
+#define CONTROL_RATE_MIN_HZ        1000
+#define CONTROL_RATE_MAX_HZ        5000
+
+// Speed feedback
+#define DEFAULT_RATED_SPEED_RPM    150     // Đo lại cho từng motor/spool
+#define RATED_SPEED_MAX_RPM        6000
+
+// Motion profile
+#define DEFAULT_PROFILE_JERK_MS    0       // Hình thang
+#define PROFILE_MAX_JERK_MS        1000
+
 
 // Default Values for Motor Registers
 #define DEFAULT_CONTROL_MODE       1       // ONOFF mode
@@ -0,0 +1,72 @@
+#ifndef __MOTION_PROFILE_H__
+#define __MOTION_PROFILE_H__
+
+#include <stdint.h>
+#include "FixedPoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// HỒ SƠ CHUYỂN ĐỘNG CHO POSITION MODE (hình thang / S-curve)
+// ═══════════════════════════════════════════════════════════════════════════════
+// - Khi đích đổi, lập hồ sơ hình thang từ trạng thái hiện tại (vị trí + vận tốc):
+//   tăng tốc A -> chạy đều V -> giảm tốc D, tối đa 4 đoạn gia tốc hằng số.
+//   Đang chạy ngược hướng đích hoặc không kịp dừng: hãm về 0 trước rồi mới quay lại
+// - S-curve: hình thang lọc trung bình trượt độ dài Tj. Gia tốc tăng/giảm tuyến tính
+//   trong Tj (jerk = A / Tj), không vượt V/A/D, hồ sơ dài thêm đúng Tj.
+//   Tích phân hình thang tính giải tích nên không cần buffer lịch sử
+// - Đơn vị Q16.16: cm, cm/s, cm/s²; thời gian giây. Mỗi tick chỉ cộng/nhân 64 bit,
+//   phép chia và căn bậc hai chỉ có lúc lập hồ sơ
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define PROFILE_MAX_SEGMENTS    4
+
+typedef struct {
+    q16_t max_velocity;         // cm/s
+    q16_t acceleration;         // cm/s²
+    q16_t deceleration;         // cm/s²
+    q16_t jerk_time;            // s - thời gian tăng/giảm gia tốc, 0 = hình thang
+} ProfileLimits_t;
+
+typedef struct {
+    q16_t duration;             // s
+    q16_t acceleration;         // cm/s² (có dấu)
+} ProfileSegment_t;
+
+typedef struct {
+    q16_t start_position;       // cm
+    q16_t start_velocity;       // cm/s
+    q16_t end_time;             // s - tổng thời gian các đoạn
+    uint8_t segment_count;
+    ProfileSegment_t segments[PROFILE_MAX_SEGMENTS];
+} ProfilePlan_t;
+
+typedef struct {
+    ProfilePlan_t plan;
+    ProfilePlan_t previous;     // Plan trước lần đổi đích - cửa sổ S-curve còn với tới
+    q16_t previous_switch;      // Thời điểm đổi plan, tính trên trục thời gian của previous
+    int64_t previous_integral;  // Tích phân vị trí của previous tới previous_switch
+    uint8_t has_previous;
+    uint64_t time;              // Thời gian từ đầu plan (giây, Q32.32)
+    ProfileLimits_t limits;     // Giới hạn của plan đang chạy
+    q16_t inverse_jerk_time;    // 1 / Tj
+    q16_t target;               // Đích của plan đang chạy (cm)
+    ProfileLimits_t pending_limits;
+    q16_t pending_target;       // Đích/giới hạn mới, áp dụng ở MotionProfile_Update
+    q16_t position;             // Tham chiếu vị trí cho vòng vị trí (cm)
+    q16_t velocity;             // Tham chiếu vận tốc - feedforward (cm/s)
+    uint8_t active;             // 0: lần Update tới phải Reset từ vị trí đo được
+    uint8_t done;               // Tham chiếu đã tới đích và đứng yên
+} MotionProfile_t;
+
+void MotionProfile_Reset(MotionProfile_t* profile, q16_t position);
+void MotionProfile_SetTarget(MotionProfile_t* profile, q16_t target, const ProfileLimits_t* limits);
+void MotionProfile_Update(MotionProfile_t* profile, uint32_t dtQ32);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
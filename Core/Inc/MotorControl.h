@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "main.h"
+#include "FixedPoint.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,15 +60,30 @@ typedef struct {
     uint16_t Position_Target;     // Base + 0x0F
 } MotorRegisterMap_t;
 
+// Toàn bộ giá trị PID ở Q16.16 (FixedPoint.h) - Cortex-M3 không có FPU
 typedef struct {
-    float integral;             // Accumulated error
-    float last_error;          // Previous error
-    float output;              // Current output
-    float error;               // Current error
-    float max_integral;        // Anti-windup limit
-    float acceleration_limit;   // Rate of change limit
-    float max_output;    
-    float simulated_output; // Simulated output
+    q16_t integral;             // Accumulated error × s
+    q16_t last_error;          // Previous error
+    q16_t output;              // Current output
+    q16_t error;               // Current error
+    q16_t max_integral;        // Anti-windup limit
+    q16_t acceleration_limit;   // Rate of change limit (%/s)
+    q16_t max_output;    
+    q16_t simulated_output; // Simulated output
+    q16_t setpoint;             // Lần tính gần nhất - cho telemetry
+    q16_t feedback;
+    q16_t p_term;
+    q16_t i_term;
+    q16_t d_term;
+    // Gain tính sẵn 1 lần khi PID_Kp/Ki/Kd (×100) đổi, không chia lại mỗi chu kỳ
+    q16_t kp;
+    q16_t ki;
+    q16_t kd;
+    q16_t integral_limit;       // Anti-windup PID tốc độ: max_output / ki
+    uint8_t kp_raw;
+    uint8_t ki_raw;
+    uint8_t kd_raw;
+    uint8_t gains_valid;
 } PIDState_t;
 //------------------------------------------
 //  Vùng nhớ ánh xạ thanh ghi
@@ -152,12 +168,18 @@ void Motor2_OutputPWM(MotorRegisterMap_t* motor, uint8_t duty_percent);  // moto
 // Điều khiển chiều quay motor
 void Motor_SetDirection(uint8_t motor_id, uint8_t direction);  // 0=Idle, 1=Forward, 2=Reverse
 
-// Khởi tạo giá trị PID cho từng motor
-void PID_Init(uint8_t motor_id, float kp, float ki, float kd);
+// Khởi tạo giá trị PID cho từng motor (gain ×100 như thanh ghi)
+void PID_Init(uint8_t motor_id, uint8_t kp, uint8_t ki, uint8_t kd);
 
-// Tính toán PID mỗi chu kỳ
-float PID_Compute(uint8_t motor_id, float setpoint, float feedback);
-float PID_Compute_Position(uint8_t motor_id, float setpoint, float feedback);
+// Tính toán PID mỗi chu kỳ (Q16.16)
+q16_t PID_Compute(uint8_t motor_id, q16_t setpoint, q16_t feedback);
+q16_t PID_Compute_Position(uint8_t motor_id, q16_t setpoint, q16_t feedback);
+
+// Nhịp vòng điều khiển: TIM3 CC4 đánh thức MotorTask ở Control_Rate_Hz (0x0124)
+void ControlLoop_Start(void);           // Gọi 1 lần từ MotorTask
+void ControlLoop_WaitTick(void);        // Block tới tick kế tiếp và đo dt của chu kỳ
+void ControlLoop_ResetStats(void);
+void handleControlTickInterrupt(void);  // Gọi từ TIM3_IRQHandler
 
 // Reset các lỗi nếu có
 void Motor_ResetError(MotorRegisterMap_t* motor);
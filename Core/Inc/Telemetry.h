@@ -0,0 +1,39 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+#include "MotorControl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// BULK TELEMETRY (FC 0x41, user-defined)
+// ═══════════════════════════════════════════════════════════════════════════════
+// MotorTask ghi 1 sample/chu kỳ điều khiển của motor chọn ở Telemetry_Motor vào
+// ring buffer SPSC; UartTask rút nhiều sample nhất có thể trong 1 response FC 0x41.
+// Producer chỉ ghi head, consumer chỉ ghi tail - không cần khóa.
+//
+// Request:  [addr][0x41][Max_Samples Hi][Lo][CRC]    (Max_Samples = 0: tối đa)
+// Response: [addr][0x41][N][Pending Hi][Lo][N x 20 byte sample][CRC]
+// Sample (big-endian): Seq(2) Timestamp_us(4) Setpoint x10(2) Feedback x10(2)
+//                      P x100(2) I x100(2) D x100(2) Duty %(2) Encoder_Count(2)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define TELEMETRY_FUNCTION_CODE         0x41
+#define TELEMETRY_RING_SIZE             64      // Lũy thừa của 2; 64 ms ở 1 kHz
+#define TELEMETRY_SAMPLE_BYTES          20
+#define TELEMETRY_SAMPLES_PER_FRAME     12      // 7 + 12 x 20 = 247 byte <= 256
+
+void Telemetry_Record(uint8_t motorId, const PIDState_t *pid, uint8_t duty);    // MotorTask
+uint8_t Telemetry_Drain(uint8_t *dest, uint8_t maxSamples);                     // UartTask
+uint16_t Telemetry_Pending(void);
+void Telemetry_Flush(void);                                                     // UartTask
+void Telemetry_UpdateRegisters(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,21 +5,75 @@
 #include <stdint.h>
 #include <string.h>
 #include "cmsis_os.h"
+#include "ModbusCRC.h"
 
 #define MODBUS_SLAVE_ADDRESS    3
+#define MODBUS_BROADCAST_ADDRESS 0
 #define MODBUS_BAUDRATE         115200
 #define HOLDING_REG_START       0x0000
-#define HOLDING_REG_COUNT       300  // Increased to cover all register addresses
+#define HOLDING_REG_COUNT       320  // Increased to cover all register addresses (0x0000-0x013F)
 #define INPUT_REG_START         0x0000
 #define INPUT_REG_COUNT         5
 #define COIL_START              0x0000
-#define COIL_COUNT              8
+#define COIL_COUNT              4
 #define DISCRETE_START          0x0000
-#define DISCRETE_COUNT          4
+#define DISCRETE_COUNT          3
+#define COIL_OUT1               0       // Relay OUT1 (DO1_Control)
+#define COIL_OUT2               1       // Relay OUT2 (DO2_Control)
+#define COIL_M1_ENABLE          2
+#define COIL_M2_ENABLE          3
 #define RX_BUFFER_SIZE          256
+#define RX_DMA_BUFFER_SIZE      (RX_BUFFER_SIZE + 64)  // Circular DMA buffer (> 1 frame)
+#define TX_BUFFER_SIZE          256     // Max Modbus RTU ADU
+#define TX_TIMEOUT_MS           500     // > 256 byte @ 9600 baud
+#define MODBUS_MAX_READ_REGISTERS   125
+#define MODBUS_MAX_WRITE_REGISTERS  123
+#define MODBUS_MAX_RW_WRITE_REGISTERS 121    // FC 0x17
+#define MODBUS_MAX_READ_BITS        2000    // FC 1/2
+#define MODBUS_MAX_WRITE_BITS       1968    // FC 15
+#define SYNC_STAGED_START       0x0000  // Arm/trigger áp dụng cho block Motor 1 + Motor 2
+#define SYNC_STAGED_COUNT       32
+#define DIRTY_BITMAP_WORDS      ((HOLDING_REG_COUNT + 31) / 32)
+#define AUTOBAUD_EDGE_COUNT     16      // Số cạnh xuống đo trước khi chốt baud
+#define AUTOBAUD_TOLERANCE_PCT  5       // Sai lệch tối đa so với baud chuẩn
+#define AUTOBAUD_RELOCK_ERRORS  4       // Framing error liên tiếp -> đo lại
+#define RS485_MAX_PRE_GUARD_US  1000
+#define RS485_MAX_POST_GUARD_US 500     // TIM4 one-pulse sau ngắt TC
+#define DEVICE_VENDOR_NAME      "DC-Driver"            // FC 0x2B/0x0E object 0x00
+#define DEVICE_PRODUCT_CODE     "DCD-2M"               // object 0x01
+#define DEVICE_PRODUCT_NAME     "Dual DC Motor Driver" // object 0x04
+#define DEVICE_MODEL_NAME       "STM32F103C8T6"        // object 0x05
+#define PROCESS_IMAGE_COUNT     0x0050  // Snapshot 0x0000-0x004F (motor, I/O, encoder, cycle counter)
+#define HOLDING_PAGE_SHIFT      4       // Page 16 thanh ghi: page = addr >> 4
+#define HOLDING_PAGE_SIZE       (1U << HOLDING_PAGE_SHIFT)
+#define HOLDING_PAGE_MASK       (HOLDING_PAGE_SIZE - 1)
+#define HOLDING_PAGE_COUNT      (HOLDING_REG_COUNT >> HOLDING_PAGE_SHIFT)
+
+// ═══════════════════════════════════════════════════════════════
+// HOLDING REGISTER MAP (sparse, theo page 16 thanh ghi)
+// ═══════════════════════════════════════════════════════════════
+// Chỉ page có thanh ghi mới có bộ nhớ; FC3/6/16/23 tra bảng g_holdingPages
+// bằng addr >> 4 nên mỗi thanh ghi tốn đúng 1 lần index, không tìm kiếm.
+
+// Giới hạn giá trị master được ghi (min..max, kể cả 2 đầu)
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+} RegisterLimit_t;
+
+typedef struct {
+    uint16_t *storage;              // 16 thanh ghi của page, NULL = page không tồn tại (exception 02)
+    uint16_t writeMask;             // Bit i = 1: master được ghi thanh ghi (page << 4) + i
+    const RegisterLimit_t *limits;  // 16 giới hạn, NULL = không kiểm tra (exception 03 khi vượt)
+} HoldingRegisterPage_t;
+
+extern const HoldingRegisterPage_t g_holdingPages[HOLDING_PAGE_COUNT];
+
+// Truy cập thanh ghi từ firmware - addr phải thuộc page đã map
+#define HREG(addr)  (g_holdingPages[(addr) >> HOLDING_PAGE_SHIFT].storage[(addr) & HOLDING_PAGE_MASK])
+
 extern osMutexId_t modbusTxMutex;
 // Global register arrays
-extern uint16_t g_holdingRegisters[HOLDING_REG_COUNT];
 extern uint16_t g_inputRegisters[INPUT_REG_COUNT];
 extern uint8_t g_coils[COIL_COUNT];
 extern uint8_t g_discreteInputs[DISCRETE_COUNT];
@@ -31,12 +85,11 @@ extern uint32_t g_modbusCounter;
 
 // UART buffer variables
 extern uint8_t rxBuffer[RX_BUFFER_SIZE];
-extern uint8_t rxIndex;
+extern uint16_t rxIndex;
 extern uint8_t frameReceived;
 extern uint32_t g_lastUARTActivity;
 
-// Single byte buffer for UART reception (declared in UartModbus.c)
-// extern uint8_t rxByte;  // Static variable, không export
+// Circular DMA RX buffer (static trong UartModbus.c, không export)
 
 // Diagnostic variables
 extern uint32_t g_totalReceived;
@@ -45,6 +98,18 @@ extern uint32_t g_timeoutCount;
 extern uint32_t g_queueFullCount;
 extern uint32_t g_lastResetTime;
 extern uint8_t g_receivedIndex;
+extern uint32_t g_overrunCount;
+extern uint32_t g_uartErrorCount;
+extern uint16_t g_lastFrameBytes;
+extern uint16_t g_maxFrameBytes;
+extern uint32_t g_t15ViolationCount;
+extern uint32_t g_broadcastCount;
+extern uint32_t g_exceptionCount;
+extern uint32_t g_slaveMessageCount;
+extern uint32_t g_snapshotCycle;
+extern uint32_t g_autoBaudRate;
+extern uint16_t g_t15Us;
+extern uint16_t g_t35Us;
 
 // LED indicator flag
 extern uint8_t g_ledIndicator;
@@ -53,13 +118,19 @@ extern uint8_t g_ledIndicator;
 #define UART_MAX_TIMEOUT_COUNT 3         // Reset after 3 timeouts
 #define UART_QUEUE_TIMEOUT 10            // 10ms timeout for queue operations
 
+// Thread flags gửi tới UartTask
+#define MODBUS_FLAG_FRAME_READY    0x0001U  // ISR đã tách xong 1 frame vào rxBuffer
+#define MODBUS_FLAG_TX_DONE        0x0002U  // Response đã truyền xong (USART TC)
+#define MODBUS_FLAG_AUTOBAUD       0x0004U  // Auto-baud đo xong / cần đo lại
+
 // UART health monitoring variables
 extern uint32_t last_health_check;
 
 // Function declarations
 static void MX_USART2_UART_Init(void);
-uint16_t calcCRC(uint8_t *buf, int len);
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void handleUARTIdleInterrupt(void);
+void handleModbusTimerInterrupt(void);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
 void resetUARTCommunication(void);
 void processModbusFrame(void);
@@ -67,8 +138,15 @@ void initializeModbusRegisters(void);
 void updateSystemStatus(void);
 void updateMotorStatus(void);
 void updateDigitalIOStatus(void);
-void updateBaudrate(void);
+void updateSerialConfig(void);
+void handleAutoBaudCapture(void);
+void processAutoBaud(void);
 void checkUARTHealth(void);
 void startModbusUARTReception(void);
+void updateCommDiagnostics(void);
+void markRegistersDirty(uint16_t start, uint16_t count);
+uint8_t consumeDirtyRegisters(uint16_t start, uint16_t count);
+void saveHoldingRegister(uint16_t addr, uint16_t value);
+void publishProcessImage(void);
 
 #endif
\ No newline at end of file
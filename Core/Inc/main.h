@@ -66,14 +66,13 @@ extern I2C_HandleTypeDef hi2c1;
 
 
 // External declarations for global variables
-extern uint16_t g_holdingRegisters[];
 extern uint16_t g_inputRegisters[];
 extern uint8_t g_coils[];
 extern uint8_t g_discreteInputs[];
 extern uint32_t g_taskCounter;
 extern uint32_t g_modbusCounter;
 extern uint8_t rxBuffer[];
-extern uint8_t rxIndex;
+extern uint16_t rxIndex;
 extern uint8_t frameReceived;
 extern uint32_t g_lastUARTActivity;
 extern uint32_t g_totalReceived;
@@ -101,6 +100,8 @@ static void MX_I2C1_Init(void);
 #define LED3_GPIO_Port GPIOC
 #define LED2_Pin GPIO_PIN_15
 #define LED2_GPIO_Port GPIOC
+#define RS485_DE_Pin GPIO_PIN_1
+#define RS485_DE_GPIO_Port GPIOA
 #define DIR_1_Pin GPIO_PIN_4
 #define DIR_1_GPIO_Port GPIOA
 #define IN1_Pin GPIO_PIN_5
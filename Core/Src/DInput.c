@@ -29,7 +29,7 @@
     
 //     // Scale 100 và chuyển sang uint16
 //     uint16_t current_scaled = (uint16_t)(average * 100.0f);
-//     g_holdingRegisters[REG_CURRENT] = current_scaled;
+//     HREG(REG_CURRENT) = current_scaled;
     
 //     return current_scaled;
 // }
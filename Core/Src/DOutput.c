@@ -1,5 +1,6 @@
 #include "DOutput.h"
 #include "main.h"
+#include "UartModbus.h"
 DOutputState_t doutput_state;
 
 void DOutput_Init(void)
@@ -10,13 +11,13 @@ void DOutput_Init(void)
 }
 
 void DOutput_Load(DOutputState_t* state){
-    state->relay1 = g_holdingRegisters[0x0040];
-    state->relay2 = g_holdingRegisters[0x0041];
+    state->relay1 = (HREG(REG_DO_STATUS_WORD) & 0x0001) != 0;
+    state->relay2 = (HREG(REG_DO_STATUS_WORD) & 0x0002) != 0;
 }
 
 void DOutput_Save(DOutputState_t* state){
-    g_holdingRegisters[0x0040] = state->relay1;
-    g_holdingRegisters[0x0041] = state->relay2;
+    // Bit 0 = relay 1, bit 1 = relay 2 (coil 0/1 của FC1 đọc cùng trạng thái)
+    HREG(REG_DO_STATUS_WORD) = (state->relay1 ? 0x0001 : 0) | (state->relay2 ? 0x0002 : 0);
 }
 void DOutput_SetRelay(uint8_t channel, bool state){
     if(channel == 1){
@@ -33,18 +34,23 @@ void DOutput_GetState(DOutputState_t* state){
     state->relay2 = doutput_state.relay2;
 }
 
-void DOutput_Process(DOutputState_t* state){
-    // Relay 1 active when either motor is running (check actual running status)
-    if(g_holdingRegisters[REG_M1_ACTUAL_SPEED] > 0 || g_holdingRegisters[REG_M2_ACTUAL_SPEED] > 0) {
-        DOutput_SetRelay(1, true);
-    } else {
-        DOutput_SetRelay(1, false);
+// Chức năng tự động của từng relay
+static bool DOutput_AutoState(uint8_t channel){
+    if(channel == 1){
+        // Relay 1 active when either motor is running (check actual running status)
+        return HREG(REG_M1_ACTUAL_SPEED) > 0 || HREG(REG_M2_ACTUAL_SPEED) > 0;
     }
-
     // Relay 2 active on critical system error
-    if(g_holdingRegisters[0x0100] & 0x8000) { // Check critical error bit
-        DOutput_SetRelay(2, true); 
-    } else {
-        DOutput_SetRelay(2, false);
-    }
-}
\ No newline at end of file
+    return (HREG(0x0100) & 0x8000) != 0; // Check critical error bit
+}
+
+// Relay = chức năng tự động OR lệnh điều khiển từ Modbus (DOx_Control / coil 0-1)
+void DOutput_Update(uint8_t channel){
+    uint16_t controlReg = (channel == 1) ? REG_DO1_CONTROL : REG_DO2_CONTROL;
+    DOutput_SetRelay(channel, DOutput_AutoState(channel) || HREG(controlReg) != 0);
+}
+
+void DOutput_Process(DOutputState_t* state){
+    DOutput_Update(1);
+    DOutput_Update(2);
+}
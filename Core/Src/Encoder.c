@@ -2,6 +2,7 @@
 #include "ModbusMap.h"
 #include "main.h"
 #include "MotorControl.h"
+#include "UartModbus.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -112,6 +113,71 @@ static EncoderState_t encoder_state = {
 Encoder_t encoder1;
 //Encoder_t encoder2;
 
+// ═══════════════════════════════════════════════════════════════════════════════
+// SPEED MEASUREMENT (M/T METHOD) - phản hồi cho PID tốc độ
+// ═══════════════════════════════════════════════════════════════════════════════
+// - Encoder chỉ gắn trên spool Motor 1 (TIM2_CH1), Motor 2 không có phản hồi tốc độ
+// - TIM2 đếm xuống ở 72 MHz (PSC = 0, auto-baud cần độ phân giải này trên CH4):
+//   mỗi cạnh xuống DMA chép CCR1 vào dma_capture_buffer
+// - Counter 16 bit vòng mỗi 0.91 ms, nhanh hơn chu kỳ điều khiển 1 ms, nên trục
+//   thời gian 32 bit được mở rộng trong ngắt TIM2: update + CC3 ở giữa vòng, ~455 µs
+//   1 lần. now_ticks cộng dồn (CNT trước - CNT), tuổi của cạnh = (capture - CNT);
+//   giữa 2 lần lấy mẫu < 1 vòng nên cả 2 phép trừ 16 bit không nhập nhằng
+// - M/T: tốc độ = M cạnh / khoảng thời gian T giữa 2 cạnh đo được, cả 2 đầu T nằm
+//   đúng trên cạnh nên không có sai số ±1 xung như đếm xung trong cửa sổ cố định.
+//   Tốc độ cao: gom nhiều cạnh tới T >= SPEED_MIN_PERIOD_US. Tốc độ thấp: mỗi cạnh
+//   cho 1 kết quả (T-method)
+// - Lâu không có cạnh: tốc độ không thể lớn hơn 1 xung / thời gian từ cạnh cuối,
+//   giảm dần theo giới hạn đó; quá SPEED_TIMEOUT_US thì = 0
+// - Encoder 1 kênh: tốc độ luôn dương, chiều lấy theo Motor 1 Direction
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define SPEED_MOTOR_ID          1
+#define SPEED_MIN_PERIOD_US     2000U
+#define SPEED_TIMEOUT_US        1000000U
+#define SPEED_RPM_NUMERATOR     (60ULL * 1000000ULL)   // RPM = cạnh × 60e6 × tick/µs / (xung/vòng × T tick)
+#define SPEED_SAMPLE_COMPARE    0x8000U                 // CCR3: mẫu thứ 2 giữa mỗi vòng TIM2
+
+// Ghi trong ngắt TIM2 (và trong Encoder_UpdateSpeed khi đã khóa ngắt)
+typedef struct {
+    uint32_t last_dma_counter;      // DMA counter ở lần lấy mẫu trước
+    uint16_t last_timer_count;      // TIM2 CNT ở lần lấy mẫu trước
+    uint32_t now_ticks;             // Trục thời gian tick TIM2 mở rộng 32 bit (vòng ~59 s)
+    uint32_t edge_total;            // Tổng số cạnh đã quy đổi
+    uint32_t last_edge_ticks;       // Thời điểm cạnh mới nhất
+    bool initialized;
+} EdgeTimeline_t;
+
+// Chỉ MotorTask dùng
+typedef struct {
+    uint32_t ticks_per_us;          // Clock TIM2 / 1 MHz
+    uint32_t ref_edge_ticks;        // Cạnh mở khoảng T đang đo
+    uint32_t ref_edge_total;        // edge_total tại ref_edge_ticks
+    uint32_t edge_period_ticks;     // Chu kỳ 1 xung của kết quả gần nhất
+    bool has_edge;                  // ref_edge_ticks hợp lệ
+    q16_t rpm;                      // Kết quả gần nhất
+    bool initialized;
+} SpeedState_t;
+
+static volatile EdgeTimeline_t edge_timeline = {
+    .last_dma_counter = 0,
+    .last_timer_count = 0,
+    .now_ticks = 0,
+    .edge_total = 0,
+    .last_edge_ticks = 0,
+    .initialized = false
+};
+
+static SpeedState_t speed_state = {
+    .ticks_per_us = 0,
+    .ref_edge_ticks = 0,
+    .ref_edge_total = 0,
+    .edge_period_ticks = 0,
+    .has_edge = false,
+    .rpm = 0,
+    .initialized = false
+};
+
 /**
  * @brief Initialize encoder hardware and state variables
  * 
@@ -151,6 +217,11 @@ void Encoder_Init(void){
     // Start Input Capture with DMA (Circular mode)
     // DMA sẽ tự động lưu giá trị CCR1 mỗi khi có cạnh xuống
     HAL_TIM_IC_Start_DMA(&htim2, TIM_CHANNEL_1, dma_capture_buffer, DMA_BUFFER_SIZE);
+
+    // Mở rộng trục thời gian encoder 2 lần mỗi vòng TIM2: update + CC3 (không dùng chân)
+    __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_3, SPEED_SAMPLE_COMPARE);
+    __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE | TIM_FLAG_CC3);
+    __HAL_TIM_ENABLE_IT(&htim2, TIM_IT_UPDATE | TIM_IT_CC3);
     
     // Initialize encoder state tracking
     encoder_state.unrolled_length_mm = 0.0f;
@@ -279,15 +350,15 @@ void Encoder_Load(Encoder_t* encoder){
     // CONFIGURATION REGISTERS (Modbus Master → Firmware)
     // ═══════════════════════════════════════════════════════════════
     
-    encoder->Revolutions = g_holdingRegisters[REG_ENCODER_REVOLUTIONS];
-    encoder->Rmax = g_holdingRegisters[REG_ENCODER_RMAX];
-    encoder->Rmin = g_holdingRegisters[REG_ENCODER_RMIN];
-    encoder->Wire_Length_CM = g_holdingRegisters[REG_ENCODER_WIRE_LENGTH_CM];
-    encoder->Encoder_Reset = g_holdingRegisters[REG_ENCODER_RESET];
-    encoder->Encoder_Calib_Length_CM_Max = g_holdingRegisters[REG_ENCODER_CALIB_WIRE_LENGTH_CM];
-    encoder->Encoder_Calib_Status = g_holdingRegisters[REG_ENCODER_CALIB_STATUS];
-    encoder->Encoder_Calib_Current_Length_CM = g_holdingRegisters[REG_ENCODER_CALIB_CURRENT_LENGTH_CM];
-    encoder->Calib_Origin_Status = g_holdingRegisters[REG_ENCODER_CALIB_ORIGIN_STATUS] ? true : false;
+    encoder->Revolutions = HREG(REG_ENCODER_REVOLUTIONS);
+    encoder->Rmax = HREG(REG_ENCODER_RMAX);
+    encoder->Rmin = HREG(REG_ENCODER_RMIN);
+    encoder->Wire_Length_CM = HREG(REG_ENCODER_WIRE_LENGTH_CM);
+    encoder->Encoder_Reset = HREG(REG_ENCODER_RESET);
+    encoder->Encoder_Calib_Length_CM_Max = HREG(REG_ENCODER_CALIB_WIRE_LENGTH_CM);
+    encoder->Encoder_Calib_Status = HREG(REG_ENCODER_CALIB_STATUS);
+    encoder->Encoder_Calib_Current_Length_CM = HREG(REG_ENCODER_CALIB_CURRENT_LENGTH_CM);
+    encoder->Calib_Origin_Status = HREG(REG_ENCODER_CALIB_ORIGIN_STATUS) ? true : false;
 
     
     // ═══════════════════════════════════════════════════════════════
@@ -338,19 +409,19 @@ void Encoder_Save(Encoder_t* encoder){
     // ═══════════════════════════════════════════════════════════════
     // MEASURED VALUES (Firmware → Modbus Master)
     // ═══════════════════════════════════════════════════════════════
-    g_holdingRegisters[REG_ENCODER_COUNT    ] = encoder->Encoder_Count;
-    g_holdingRegisters[REG_ENCODER_REVOLUTIONS] = encoder->Revolutions;
-    g_holdingRegisters[REG_ENCODER_RMAX] = encoder->Rmax;
-    g_holdingRegisters[REG_ENCODER_RMIN] = encoder->Rmin;
-    g_holdingRegisters[REG_ENCODER_WIRE_LENGTH_CM] = encoder->Wire_Length_CM;
-    g_holdingRegisters[REG_ENCODER_RESET] = encoder->Encoder_Reset;
-    g_holdingRegisters[REG_ENCODER_CALIB_WIRE_LENGTH_CM] = encoder->Encoder_Calib_Length_CM_Max;
-    g_holdingRegisters[REG_ENCODER_CALIB_STATUS] = encoder->Encoder_Calib_Status;
-    g_holdingRegisters[REG_ENCODER_CALIB_CURRENT_LENGTH_CM] = encoder->Encoder_Calib_Current_Length_CM;
-    g_holdingRegisters[REG_ENCODER_CALIB_ORIGIN_STATUS] = encoder->Calib_Origin_Status ? 1 : 0;
-    g_holdingRegisters[REG_ENCODER_UNROLLED_WIRE_LENGTH_CM] = encoder->Unrolled_Wire_Length_CM;
-    
-    g_holdingRegisters[REG_ENCODER_STATUS_WORD] = encoder->Status_Word;
+    HREG(REG_ENCODER_COUNT    ) = encoder->Encoder_Count;
+    saveHoldingRegister(REG_ENCODER_REVOLUTIONS, encoder->Revolutions);
+    saveHoldingRegister(REG_ENCODER_RMAX, encoder->Rmax);
+    saveHoldingRegister(REG_ENCODER_RMIN, encoder->Rmin);
+    saveHoldingRegister(REG_ENCODER_WIRE_LENGTH_CM, encoder->Wire_Length_CM);
+    saveHoldingRegister(REG_ENCODER_RESET, encoder->Encoder_Reset);
+    saveHoldingRegister(REG_ENCODER_CALIB_WIRE_LENGTH_CM, encoder->Encoder_Calib_Length_CM_Max);
+    saveHoldingRegister(REG_ENCODER_CALIB_STATUS, encoder->Encoder_Calib_Status);
+    saveHoldingRegister(REG_ENCODER_CALIB_CURRENT_LENGTH_CM, encoder->Encoder_Calib_Current_Length_CM);
+    saveHoldingRegister(REG_ENCODER_CALIB_ORIGIN_STATUS, encoder->Calib_Origin_Status ? 1 : 0);
+    HREG(REG_ENCODER_UNROLLED_WIRE_LENGTH_CM) = encoder->Unrolled_Wire_Length_CM;
+    
+    HREG(REG_ENCODER_STATUS_WORD) = encoder->Status_Word;
 }
 
 void Encoder_Process(Encoder_t* encoder){
@@ -530,6 +601,131 @@ uint16_t Encoder_MeasureLength(Encoder_t* encoder) {
     return (uint16_t)encoder_state.filtered_length_mm;
 }
 
+// Tốc độ (RPM, Q16.16) khi M cạnh cách nhau period_us
+static q16_t speedFromPeriod(uint32_t edges, uint32_t period_ticks){
+    uint16_t pulses_per_rev = (encoder1.Revolutions != 0) ? encoder1.Revolutions : ENCODER_PPR;
+    uint64_t numerator = ((uint64_t)edges * SPEED_RPM_NUMERATOR * speed_state.ticks_per_us) << Q16_SHIFT;
+    return q16Saturate((int64_t)(numerator / ((uint64_t)pulses_per_rev * period_ticks)));
+}
+
+// Quy các capture mới trong DMA buffer về trục thời gian 32 bit. Giữa 2 lần gọi phải
+// < 1 vòng TIM2 (0.91 ms) - ngắt TIM2 bảo đảm điều đó, MotorTask gọi thêm khi khóa ngắt
+static void extendEdgeTimeline(void){
+    // Đọc DMA counter trước CNT: mọi cạnh đã nằm trong buffer đều xảy ra trước CNT
+    uint32_t dma_counter = __HAL_DMA_GET_COUNTER(htim2.hdma[TIM_DMA_ID_CC1]);
+    uint16_t timer_count = (uint16_t)htim2.Instance->CNT;
+
+    if (!edge_timeline.initialized) {
+        edge_timeline.last_dma_counter = dma_counter;
+        edge_timeline.last_timer_count = timer_count;
+        edge_timeline.initialized = true;
+        return;
+    }
+
+    // Counter đếm xuống: thời gian trôi qua = trước - sau (16 bit)
+    uint32_t now_ticks = edge_timeline.now_ticks + (uint16_t)(edge_timeline.last_timer_count - timer_count);
+    edge_timeline.now_ticks = now_ticks;
+    edge_timeline.last_timer_count = timer_count;
+
+    // Các cạnh mới: từ vị trí ghi cũ tới vị trí ghi hiện tại của DMA (circular)
+    uint32_t index = DMA_BUFFER_SIZE - edge_timeline.last_dma_counter;
+    uint32_t end = DMA_BUFFER_SIZE - dma_counter;
+    edge_timeline.last_dma_counter = dma_counter;
+    while (index != end) {
+        edge_timeline.last_edge_ticks = now_ticks - (uint16_t)(dma_capture_buffer[index] - timer_count);
+        edge_timeline.edge_total++;
+        index = (index + 1U) % DMA_BUFFER_SIZE;
+    }
+}
+
+/**
+ * @brief Gọi từ TIM2_IRQHandler trước HAL_TIM_IRQHandler: update / CC3 -> lấy mẫu trục thời gian
+ */
+void Encoder_HandleTimerInterrupt(void){
+    bool sample = false;
+    if (__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_UPDATE) && __HAL_TIM_GET_IT_SOURCE(&htim2, TIM_IT_UPDATE)) {
+        __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE);
+        sample = true;
+    }
+    if (__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_CC3) && __HAL_TIM_GET_IT_SOURCE(&htim2, TIM_IT_CC3)) {
+        __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC3);
+        sample = true;
+    }
+    if (sample) {
+        extendEdgeTimeline();
+    }
+}
+
+/**
+ * @brief Cập nhật tốc độ đo - gọi từ MotorTask mỗi chu kỳ điều khiển
+ *
+ * Lấy thêm 1 mẫu trục thời gian (khóa ngắt vài chục cycle), phép chia 64 bit chỉ
+ * chạy khi có kết quả M/T mới hoặc đang giảm dần lúc không có cạnh.
+ * Dùng last_dma_counter riêng nên không ảnh hưởng Encoder_Read của EncoderTask.
+ */
+void Encoder_UpdateSpeed(void){
+    // Mẫu mới nhất của trục thời gian; khóa ngắt để TIM2 ISR không quy đổi cùng lúc
+    __disable_irq();
+    extendEdgeTimeline();
+    uint32_t now_ticks = edge_timeline.now_ticks;
+    uint32_t edge_total = edge_timeline.edge_total;
+    uint32_t last_edge_ticks = edge_timeline.last_edge_ticks;
+    __enable_irq();
+
+    if (!speed_state.initialized) {
+        // TIM2 clock = 2 x PCLK1 (APB1 prescaler = 2)
+        speed_state.ticks_per_us = HAL_RCC_GetPCLK1Freq() * 2 / (htim2.Instance->PSC + 1) / 1000000U;
+        speed_state.ref_edge_total = edge_total;
+        speed_state.has_edge = false;
+        speed_state.rpm = 0;
+        speed_state.initialized = true;
+        return;
+    }
+
+    if (!speed_state.has_edge && edge_total != speed_state.ref_edge_total) {
+        speed_state.ref_edge_ticks = last_edge_ticks;
+        speed_state.ref_edge_total = edge_total;
+        speed_state.has_edge = true;
+    }
+
+    if (speed_state.has_edge) {
+        uint32_t edges = edge_total - speed_state.ref_edge_total;
+        uint32_t period_ticks = last_edge_ticks - speed_state.ref_edge_ticks;
+        uint32_t idle_ticks = now_ticks - last_edge_ticks;
+        if (edges > 0 && period_ticks >= SPEED_MIN_PERIOD_US * speed_state.ticks_per_us) {
+            speed_state.rpm = speedFromPeriod(edges, period_ticks);
+            speed_state.edge_period_ticks = period_ticks / edges;
+            speed_state.ref_edge_ticks = last_edge_ticks;
+            speed_state.ref_edge_total = edge_total;
+        } else if (idle_ticks >= SPEED_TIMEOUT_US * speed_state.ticks_per_us) {
+            speed_state.rpm = 0;
+            speed_state.has_edge = false;
+            speed_state.ref_edge_total = edge_total;
+        } else if (speed_state.rpm != 0 && idle_ticks > speed_state.edge_period_ticks) {
+            // Cạnh kế tiếp đã trễ hơn chu kỳ vừa đo: motor đang chậm lại
+            speed_state.rpm = speedFromPeriod(1, idle_ticks);
+        }
+    }
+
+    q16_t signed_rpm = (motor1.Direction == REVERSE) ? -speed_state.rpm : speed_state.rpm;
+    HREG(REG_SPEED_M1_RPM_X10) = (uint16_t)q16ToInt16Scaled(signed_rpm, 10);
+}
+
+bool Encoder_HasSpeedFeedback(uint8_t motor_id){
+    return motor_id == SPEED_MOTOR_ID;
+}
+
+/**
+ * @brief Tốc độ spool đo được (RPM, Q16.16, không dấu)
+ * @return 0 nếu motor không có encoder
+ */
+q16_t Encoder_GetSpeedRpm(uint8_t motor_id){
+    if (motor_id != SPEED_MOTOR_ID) {
+        return 0;
+    }
+    return speed_state.rpm;
+}
+
 /**
  * @brief Reset encoder position tracking to initial state (full spool)
  * 
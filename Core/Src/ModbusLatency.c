@@ -0,0 +1,171 @@
+#include "ModbusLatency.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+#include "stm32f1xx_hal.h"
+#include <string.h>
+
+typedef struct {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint16_t buckets[LATENCY_BUCKET_COUNT];
+} LatencyStats_t;
+
+static const uint16_t bucketLimitUs[LATENCY_BUCKET_COUNT - 1] = {
+    250, 500, 1000, 2000, 5000, 10000
+};
+
+// Function code -> slot (0 = không thống kê riêng, chỉ vào slot tổng)
+static const uint8_t trackedFuncCodes[LATENCY_FC_SLOTS] = {
+    0, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08, 0x0F, 0x10, 0x17, 0x2B, 0x41
+};
+
+static LatencyStats_t stats[LATENCY_FC_SLOTS];
+
+// Mốc của transaction đang chạy (cycle DWT)
+static volatile uint32_t rxEndCycles = 0;
+static uint32_t processStartCycles = 0;
+static volatile uint32_t txStartCycles = 0;
+static volatile uint8_t txFuncCode = 0;
+static volatile uint8_t txPending = 0;
+
+// Chi tiết transaction gần nhất (µs)
+static volatile uint16_t lastWakeupUs = 0;
+static volatile uint16_t lastProcessUs = 0;
+static volatile uint16_t lastTxUs = 0;
+
+static inline uint32_t cyclesToUs(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+static void clearStats(LatencyStats_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->minUs = 0xFFFFFFFFU;
+}
+
+// Bật DWT CYCCNT nếu chưa bật (không reset counter đang chạy)
+void ModbusLatency_EnableCycleCounter(void) {
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+
+void ModbusLatency_Init(void) {
+    ModbusLatency_EnableCycleCounter();
+    ModbusLatency_Reset();
+}
+
+void ModbusLatency_MarkRxEnd(void) {
+    rxEndCycles = DWT->CYCCNT;
+}
+
+void ModbusLatency_MarkProcessStart(void) {
+    processStartCycles = DWT->CYCCNT;
+}
+
+void ModbusLatency_MarkTxStart(uint8_t funcCode) {
+    uint32_t now = DWT->CYCCNT;
+
+    lastWakeupUs = (uint16_t)cyclesToUs(processStartCycles - rxEndCycles);
+    lastProcessUs = (uint16_t)cyclesToUs(now - processStartCycles);
+    txFuncCode = funcCode & 0x7F;
+    txStartCycles = now;
+    txPending = 1;
+}
+
+static void addSample(LatencyStats_t *s, uint32_t us) {
+    uint8_t bucket = 0;
+
+    while (bucket < LATENCY_BUCKET_COUNT - 1 && us >= bucketLimitUs[bucket]) {
+        bucket++;
+    }
+    s->count++;
+    if (s->buckets[bucket] != 0xFFFF) {
+        s->buckets[bucket]++;
+    }
+    if (us < s->minUs) {
+        s->minUs = us;
+    }
+    if (us > s->maxUs) {
+        s->maxUs = us;
+    }
+}
+
+void ModbusLatency_MarkTxDone(void) {
+    if (!txPending) {
+        return;
+    }
+    txPending = 0;
+
+    uint32_t now = DWT->CYCCNT;
+    uint32_t totalUs = cyclesToUs(now - rxEndCycles);
+    lastTxUs = (uint16_t)cyclesToUs(now - txStartCycles);
+
+    addSample(&stats[0], totalUs);
+    for (uint8_t i = 1; i < LATENCY_FC_SLOTS; i++) {
+        if (trackedFuncCodes[i] == txFuncCode) {
+            addSample(&stats[i], totalUs);
+            break;
+        }
+    }
+}
+
+void ModbusLatency_Reset(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i < LATENCY_FC_SLOTS; i++) {
+        clearStats(&stats[i]);
+    }
+    __set_PRIMASK(primask);
+}
+
+// p99 = giới hạn trên của bucket chứa mẫu thứ 99%; bucket cuối dùng max
+static uint16_t percentile99(const LatencyStats_t *s) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        total += s->buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint32_t target = (total * 99 + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+        seen += s->buckets[i];
+        if (seen >= target) {
+            return bucketLimitUs[i];
+        }
+    }
+    return (s->maxUs > 0xFFFF) ? 0xFFFF : (uint16_t)s->maxUs;
+}
+
+// Gọi từ UartTask: hiển thị slot của FC chọn ở Latency_FC_Select (0 = mọi FC)
+void ModbusLatency_UpdateRegisters(void) {
+    uint8_t slot = 0;
+    for (uint8_t i = 1; i < LATENCY_FC_SLOTS; i++) {
+        if (trackedFuncCodes[i] == HREG(REG_LATENCY_FC_SELECT)) {
+            slot = i;
+            break;
+        }
+    }
+
+    LatencyStats_t s;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    s = stats[slot];
+    __set_PRIMASK(primask);
+
+    HREG(REG_LATENCY_COUNT) = (s.count > 0xFFFF) ? 0xFFFF : (uint16_t)s.count;
+    HREG(REG_LATENCY_MIN_US) = (s.count == 0) ? 0 : (s.minUs > 0xFFFF) ? 0xFFFF : (uint16_t)s.minUs;
+    HREG(REG_LATENCY_MAX_US) = (s.maxUs > 0xFFFF) ? 0xFFFF : (uint16_t)s.maxUs;
+    HREG(REG_LATENCY_P99_US) = percentile99(&s);
+    HREG(REG_LATENCY_LAST_WAKEUP_US) = lastWakeupUs;
+    HREG(REG_LATENCY_LAST_PROCESS_US) = lastProcessUs;
+    HREG(REG_LATENCY_LAST_TX_US) = lastTxUs;
+    for (uint8_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        HREG(REG_LATENCY_BUCKET_START + i) = s.buckets[i];
+    }
+}
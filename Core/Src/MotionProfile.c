@@ -0,0 +1,242 @@
+#include "MotionProfile.h"
+
+// Trạng thái hình thang tại 1 thời điểm
+typedef struct {
+    q16_t position;         // cm
+    q16_t velocity;         // cm/s
+    int64_t integral;       // ∫ position dt từ đầu plan (cm·s, Q16)
+} ProfilePoint_t;
+
+// Quãng đường đổi vận tốc 0 <-> v với gia tốc a: v² / 2a
+static q16_t rampDistance(q16_t velocity, q16_t acceleration) {
+    return q16Saturate(((int64_t)velocity * velocity) / (2 * (int64_t)acceleration));
+}
+
+// Thời gian đổi vận tốc một lượng dv với gia tốc a: dv / a
+static q16_t rampDuration(q16_t delta_velocity, q16_t acceleration) {
+    return q16Saturate(((int64_t)delta_velocity << Q16_SHIFT) / acceleration);
+}
+
+static void addSegment(ProfilePlan_t* plan, q16_t duration, q16_t acceleration) {
+    if (duration <= 0 || plan->segment_count >= PROFILE_MAX_SEGMENTS) {
+        return;
+    }
+    plan->segments[plan->segment_count].duration = duration;
+    plan->segments[plan->segment_count].acceleration = acceleration;
+    plan->segment_count++;
+    plan->end_time = q16Add(plan->end_time, duration);
+}
+
+static uint8_t limitsEqual(const ProfileLimits_t* a, const ProfileLimits_t* b) {
+    return a->max_velocity == b->max_velocity && a->acceleration == b->acceleration &&
+           a->deceleration == b->deceleration && a->jerk_time == b->jerk_time;
+}
+
+/**
+ * @brief Lập hồ sơ hình thang từ (position, velocity) tới target, dừng hẳn ở target
+ * @note  Tính trong hệ "hướng về đích": s = quãng đường còn lại, u = vận tốc về phía đích
+ */
+static void planMove(ProfilePlan_t* plan, q16_t position, q16_t velocity, q16_t target, const ProfileLimits_t* limits) {
+    q16_t accel = limits->acceleration;
+    q16_t decel = (limits->deceleration > 0) ? limits->deceleration : accel;
+    q16_t max_velocity = limits->max_velocity;
+
+    plan->start_position = position;
+    plan->start_velocity = velocity;
+    plan->end_time = 0;
+    plan->segment_count = 0;
+
+    // Max_Acc = Max_Dec = 0: không có gia tốc nào để hãm - đứng ngay tại chỗ
+    if (decel <= 0) {
+        plan->start_velocity = 0;
+        return;
+    }
+    // Command_Speed/Max_Speed/Max_Acc = 0: không chạy tới đích, chỉ hãm về 0
+    if (max_velocity <= 0 || accel <= 0) {
+        addSegment(plan, rampDuration(q16Abs(velocity), decel), (velocity > 0) ? -decel : decel);
+        return;
+    }
+
+    q16_t distance = q16Sub(target, position);
+    int32_t dir = (distance > 0 || (distance == 0 && velocity > 0)) ? 1 : -1;
+    int64_t remaining = (int64_t)distance * dir;
+    q16_t speed = q16Saturate((int64_t)velocity * dir);
+
+    if (speed < 0) {
+        // Đang chạy ra xa đích: hãm về 0, quãng hãm cộng thêm vào quãng còn lại
+        addSegment(plan, rampDuration(-speed, decel), dir * decel);
+        remaining += rampDistance(-speed, decel);
+        speed = 0;
+    } else if (rampDistance(speed, decel) > remaining) {
+        // Không kịp dừng ở đích: hãm về 0 sau đích rồi quay lại phần vượt
+        addSegment(plan, rampDuration(speed, decel), -dir * decel);
+        remaining = rampDistance(speed, decel) - remaining;
+        dir = -dir;
+        speed = 0;
+    }
+
+    q16_t peak;
+    if (speed > max_velocity) {
+        // Nhanh hơn V (vừa giảm Command_Speed): giảm tốc về V trước
+        addSegment(plan, rampDuration(speed - max_velocity, decel), -dir * decel);
+        remaining -= rampDistance(speed, decel) - rampDistance(max_velocity, decel);
+        peak = max_velocity;
+    } else {
+        // Đỉnh tam giác tăng A / giảm D vừa hết quãng: peak² = D × (2As + u²) / (A + D)
+        int64_t ratio = ((int64_t)decel << Q16_SHIFT) / ((int64_t)accel + decel);
+        int64_t energy = 2 * (int64_t)accel * remaining + (int64_t)speed * speed;
+        if (energy < 0) {
+            energy = 0;
+        }
+        peak = (q16_t)isqrt64((uint64_t)(energy >> Q16_SHIFT) * (uint64_t)ratio);
+        if (peak > max_velocity) {
+            peak = max_velocity;
+        }
+        if (peak < speed) {
+            peak = speed;
+        }
+        addSegment(plan, rampDuration(peak - speed, accel), dir * accel);
+        remaining -= rampDistance(peak, accel) - rampDistance(speed, accel);
+    }
+
+    q16_t stop_distance = rampDistance(peak, decel);
+    if (remaining > stop_distance && peak > 0) {
+        addSegment(plan, q16Saturate(((remaining - stop_distance) << Q16_SHIFT) / peak), 0);
+    }
+    addSegment(plan, rampDuration(peak, decel), -dir * decel);
+}
+
+/**
+ * @brief Vị trí, vận tốc và tích phân vị trí của plan tại tau (s)
+ * @note  tau < 0: đứng yên ở start_position; tau > end_time: đứng yên ở cuối plan
+ */
+static void evaluatePlan(const ProfilePlan_t* plan, q16_t tau, ProfilePoint_t* out) {
+    int64_t position = plan->start_position;
+    int64_t velocity = plan->start_velocity;
+    int64_t integral = 0;
+    q16_t remaining = tau;
+
+    for (uint8_t i = 0; i < plan->segment_count && remaining > 0; i++) {
+        q16_t t = (remaining < plan->segments[i].duration) ? remaining : plan->segments[i].duration;
+        int64_t delta_velocity = ((int64_t)plan->segments[i].acceleration * t) >> Q16_SHIFT;    // a·t
+        int64_t accel_t2 = (delta_velocity * t) >> Q16_SHIFT;                                 // a·t²
+
+        // ∫ = p·t + v·t²/2 + a·t³/6  (1/6 ≈ 10923 / 65536)
+        integral += (position * t) >> Q16_SHIFT;
+        integral += (((velocity * t) >> Q16_SHIFT) * t) >> (Q16_SHIFT + 1);
+        integral += ((((accel_t2 * t) >> Q16_SHIFT)) * 10923) >> Q16_SHIFT;
+        position += ((velocity * t) >> Q16_SHIFT) + (accel_t2 >> 1);
+        velocity += delta_velocity;
+        remaining -= t;
+    }
+    if (remaining != 0) {
+        integral += (position * remaining) >> Q16_SHIFT;
+    }
+
+    out->position = q16Saturate(position);
+    out->velocity = q16Saturate(velocity);
+    out->integral = integral;
+}
+
+// Như evaluatePlan nhưng tau < 0 rơi vào plan trước lần đổi đích (nếu có)
+static void evaluateWindow(const MotionProfile_t* profile, q16_t tau, ProfilePoint_t* out) {
+    if (tau >= 0 || !profile->has_previous) {
+        evaluatePlan(&profile->plan, tau, out);
+        return;
+    }
+    evaluatePlan(&profile->previous, q16Add(profile->previous_switch, tau), out);
+    out->integral -= profile->previous_integral;
+}
+
+static q16_t elapsedTime(const MotionProfile_t* profile) {
+    uint64_t tau = profile->time >> Q16_SHIFT;
+    return (tau > (uint64_t)Q16_MAX) ? Q16_MAX : (q16_t)tau;
+}
+
+/**
+ * @brief Đứng yên tại position, chưa có giới hạn - lần SetTarget/Update tới sẽ lập plan
+ */
+void MotionProfile_Reset(MotionProfile_t* profile, q16_t position) {
+    static const ProfileLimits_t noLimits = { 0, 0, 0, 0 };
+
+    profile->plan.start_position = position;
+    profile->plan.start_velocity = 0;
+    profile->plan.end_time = 0;
+    profile->plan.segment_count = 0;
+    profile->has_previous = 0;
+    profile->time = 0;
+    profile->limits = noLimits;
+    profile->pending_limits = noLimits;
+    profile->inverse_jerk_time = 0;
+    profile->target = position;
+    profile->pending_target = position;
+    profile->position = position;
+    profile->velocity = 0;
+    profile->active = 1;
+    profile->done = 1;
+}
+
+/**
+ * @brief Đặt đích/giới hạn mong muốn - gọi mỗi chu kỳ được, chỉ lập lại plan khi có thay đổi
+ */
+void MotionProfile_SetTarget(MotionProfile_t* profile, q16_t target, const ProfileLimits_t* limits) {
+    profile->pending_target = target;
+    profile->pending_limits = *limits;
+}
+
+/**
+ * @brief Tiến hồ sơ thêm dt (giây, Q0.32), cập nhật profile->position/velocity
+ */
+void MotionProfile_Update(MotionProfile_t* profile, uint32_t dtQ32) {
+    ProfilePoint_t head;
+    ProfilePoint_t tail;
+    q16_t tau = elapsedTime(profile);
+
+    // Đích/giới hạn mới: lập lại plan từ trạng thái hình thang hiện tại. Đang chạy thì
+    // chờ plan cũ đủ Tj để cửa sổ S-curve không với quá plan trước nữa
+    if ((profile->pending_target != profile->target || !limitsEqual(&profile->pending_limits, &profile->limits)) &&
+        (profile->done || tau >= profile->limits.jerk_time)) {
+        evaluatePlan(&profile->plan, tau, &head);
+        profile->has_previous = !profile->done;
+        if (profile->has_previous) {
+            profile->previous = profile->plan;
+            profile->previous_switch = tau;
+            profile->previous_integral = head.integral;
+        }
+        profile->target = profile->pending_target;
+        profile->limits = profile->pending_limits;
+        profile->inverse_jerk_time = (profile->limits.jerk_time > 0)
+            ? q16Saturate((1LL << (2 * Q16_SHIFT)) / profile->limits.jerk_time) : 0;
+        planMove(&profile->plan, head.position, head.velocity, profile->target, &profile->limits);
+        profile->time = 0;
+        profile->done = 0;
+    }
+    if (profile->done) {
+        return;
+    }
+
+    profile->time += dtQ32;
+    tau = elapsedTime(profile);
+
+    if (tau >= q16Add(profile->plan.end_time, profile->limits.jerk_time)) {
+        evaluatePlan(&profile->plan, profile->plan.end_time, &head);
+        profile->position = head.position;
+        profile->velocity = 0;
+        profile->has_previous = 0;
+        profile->done = 1;
+        return;
+    }
+
+    if (profile->limits.jerk_time == 0) {
+        evaluatePlan(&profile->plan, tau, &head);
+        profile->position = head.position;
+        profile->velocity = head.velocity;
+        return;
+    }
+
+    // S-curve: trung bình trượt của hình thang trên [t - Tj, t]
+    evaluateWindow(profile, tau, &head);
+    evaluateWindow(profile, tau - profile->limits.jerk_time, &tail);
+    profile->position = q16Saturate(((head.integral - tail.integral) * profile->inverse_jerk_time) >> Q16_SHIFT);
+    profile->velocity = q16Mul(q16Sub(head.position, tail.position), profile->inverse_jerk_time);
+}
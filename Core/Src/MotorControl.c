@@ -4,6 +4,10 @@
 #include "UartModbus.h"
 #include "stm32f1xx_hal.h"
 #include "Encoder.h"
+#include "Telemetry.h"
+#include "MotionProfile.h"
+#include "ModbusLatency.h"
+#include "cmsis_os.h"
 
 // Khởi tạo
 
@@ -14,93 +18,89 @@ SystemRegisterMap_t system;
 PIDState_t pid_state1;
 PIDState_t pid_state2;
 
-uint16_t mapRegisterAddress(uint16_t modbusAddress) {
-    // System registers (0x0000-0x0006)
-    if (modbusAddress <= 0x0006) {
-        return modbusAddress;
-    }
-    // Motor 1 registers (0x0010-0x001D)
-    else if (modbusAddress >= 0x0010 && modbusAddress <= 0x001D) {
-        return modbusAddress;
-    }
-    // Motor 2 registers (0x0020-0x002D)
-    else if (modbusAddress >= 0x0020 && modbusAddress <= 0x002D) {
-        return modbusAddress;
-    }
-    // Digital Input registers (0x0030-0x0034)
-    else if (modbusAddress >= 0x0030 && modbusAddress <= 0x0034) {
-        return modbusAddress;
-    }
-    // Digital Output registers (0x0040-0x0044)
-    else if (modbusAddress >= 0x0040 && modbusAddress <= 0x0044) {
-        return modbusAddress;
-    }
-    
-    return modbusAddress; // Return as is if not in any range
+// Hồ sơ chuyển động của Position mode
+static MotionProfile_t motion_profile1;
+static MotionProfile_t motion_profile2;
+
+// dt của chu kỳ điều khiển hiện tại - ControlLoop_WaitTick đo bằng DWT
+static uint32_t controlDtQ32 = (uint32_t)(0x100000000ULL / DEFAULT_CONTROL_RATE_HZ);  // Giây, Q0.32
+static uint32_t controlDtUs = 1000000U / DEFAULT_CONTROL_RATE_HZ;
+
+// Tốc độ đo từ encoder theo % Rated_Speed_RPM (0x012B) - cùng đơn vị với Command_Speed
+static q16_t measuredSpeedPercent(uint8_t motor_id) {
+    return q16Saturate((int64_t)Encoder_GetSpeedRpm(motor_id) * 100 / HREG(REG_SPEED_RATED_RPM));
 }
+
+// Tốc độ dây (cm/s) ứng với 1% Command_Speed: Rated_Speed_RPM / 100 × 2π × Rmax (mm) / 60 / 10
+// 2π / 60000 = 449768 / 2^32
+static q16_t wireSpeedPerPercent(void) {
+    uint64_t scaled = (uint64_t)HREG(REG_SPEED_RATED_RPM) * HREG(REG_ENCODER_RMAX) * 449768U;
+    return q16Saturate((int64_t)(scaled >> Q16_SHIFT));
+}
+
 // Load từ modbus registers
 void MotorRegisters_Load(MotorRegisterMap_t* motor, uint16_t base_addr) {
-    motor->Control_Mode = g_holdingRegisters[base_addr + 0x00];
-    motor->Enable = g_holdingRegisters[base_addr + 0x01];
-    motor->Command_Speed = g_holdingRegisters[base_addr + 0x02];
-    motor->Actual_Speed = g_holdingRegisters[base_addr + 0x03];
-    motor->Direction = g_holdingRegisters[base_addr + 0x04];
-    motor->Max_Speed = g_holdingRegisters[base_addr + 0x05];
-    motor->Min_Speed = g_holdingRegisters[base_addr + 0x06];
-    motor->PID_Kp = g_holdingRegisters[base_addr + 0x07];
-    motor->PID_Ki = g_holdingRegisters[base_addr + 0x08];
-    motor->PID_Kd = g_holdingRegisters[base_addr + 0x09];
-    motor->Max_Acc = g_holdingRegisters[base_addr + 0x0A];
-    motor->Max_Dec = g_holdingRegisters[base_addr + 0x0B];
-    motor->Status_Word = g_holdingRegisters[base_addr + 0x0C];
-    motor->Error_Code = g_holdingRegisters[base_addr + 0x0D];
-    motor->Position_Current = g_holdingRegisters[base_addr + 0x0E];
-    motor->Position_Target = g_holdingRegisters[base_addr + 0x0F];
+    motor->Control_Mode = HREG(base_addr + 0x00);
+    motor->Enable = HREG(base_addr + 0x01);
+    motor->Command_Speed = HREG(base_addr + 0x02);
+    motor->Actual_Speed = HREG(base_addr + 0x03);
+    motor->Direction = HREG(base_addr + 0x04);
+    motor->Max_Speed = HREG(base_addr + 0x05);
+    motor->Min_Speed = HREG(base_addr + 0x06);
+    motor->PID_Kp = HREG(base_addr + 0x07);
+    motor->PID_Ki = HREG(base_addr + 0x08);
+    motor->PID_Kd = HREG(base_addr + 0x09);
+    motor->Max_Acc = HREG(base_addr + 0x0A);
+    motor->Max_Dec = HREG(base_addr + 0x0B);
+    motor->Status_Word = HREG(base_addr + 0x0C);
+    motor->Error_Code = HREG(base_addr + 0x0D);
+    motor->Position_Current = HREG(base_addr + 0x0E);
+    motor->Position_Target = HREG(base_addr + 0x0F);
 }
 
 void SystemRegisters_Load(SystemRegisterMap_t* sys){
-    sys->Device_ID = g_holdingRegisters[REG_DEVICE_ID];
-    sys->Config_Baudrate = g_holdingRegisters[REG_CONFIG_BAUDRATE];
-    sys->Config_Parity = g_holdingRegisters[REG_CONFIG_PARITY];
-    sys->Config_Stop_Bit = g_holdingRegisters[REG_CONFIG_STOP_BIT];
-    sys->Module_Type = g_holdingRegisters[REG_MODULE_TYPE];
-    sys->Firmware_Version = g_holdingRegisters[REG_FIRMWARE_VERSION];
-    sys->Hardware_Version = g_holdingRegisters[REG_HARDWARE_VERSION];
-    sys->System_Status = g_holdingRegisters[REG_SYSTEM_STATUS];
-    sys->System_Error = g_holdingRegisters[REG_SYSTEM_ERROR];
-    sys->Reset_Error_Command = g_holdingRegisters[REG_RESET_ERROR_COMMAND];
-}
-
-// Save lại vào modbus registers
+    sys->Device_ID = HREG(REG_DEVICE_ID);
+    sys->Config_Baudrate = HREG(REG_CONFIG_BAUDRATE);
+    sys->Config_Parity = HREG(REG_CONFIG_PARITY);
+    sys->Config_Stop_Bit = HREG(REG_CONFIG_STOP_BIT);
+    sys->Module_Type = HREG(REG_MODULE_TYPE);
+    sys->Firmware_Version = HREG(REG_FIRMWARE_VERSION);
+    sys->Hardware_Version = HREG(REG_HARDWARE_VERSION);
+    sys->System_Status = HREG(REG_SYSTEM_STATUS);
+    sys->System_Error = HREG(REG_SYSTEM_ERROR);
+    sys->Reset_Error_Command = HREG(REG_RESET_ERROR_COMMAND);
+}
+
+// Save lại vào modbus registers (thanh ghi master vừa ghi được giữ nguyên tới lần Load sau)
 void MotorRegisters_Save(MotorRegisterMap_t* motor, uint16_t base_addr){
-    g_holdingRegisters[base_addr + 0x00] = motor->Control_Mode;
-    g_holdingRegisters[base_addr + 0x01] = motor->Enable;
-    g_holdingRegisters[base_addr + 0x02] = motor->Command_Speed;
-    g_holdingRegisters[base_addr + 0x03] = motor->Actual_Speed;
-    g_holdingRegisters[base_addr + 0x04] = motor->Direction;
-    g_holdingRegisters[base_addr + 0x05] = motor->Max_Speed;
-    g_holdingRegisters[base_addr + 0x06] = motor->Min_Speed;
-    g_holdingRegisters[base_addr + 0x07] = motor->PID_Kp;
-    g_holdingRegisters[base_addr + 0x08] = motor->PID_Ki;
-    g_holdingRegisters[base_addr + 0x09] = motor->PID_Kd;
-    g_holdingRegisters[base_addr + 0x0A] = motor->Max_Acc;
-    g_holdingRegisters[base_addr + 0x0B] = motor->Max_Dec;
-    g_holdingRegisters[base_addr + 0x0C] = motor->Status_Word;
-    g_holdingRegisters[base_addr + 0x0D] = motor->Error_Code;
-    g_holdingRegisters[base_addr + 0x0E] = motor->Position_Current;
-    g_holdingRegisters[base_addr + 0x0F] = motor->Position_Target;
+    saveHoldingRegister(base_addr + 0x00, motor->Control_Mode);
+    saveHoldingRegister(base_addr + 0x01, motor->Enable);
+    saveHoldingRegister(base_addr + 0x02, motor->Command_Speed);
+    saveHoldingRegister(base_addr + 0x03, motor->Actual_Speed);
+    saveHoldingRegister(base_addr + 0x04, motor->Direction);
+    saveHoldingRegister(base_addr + 0x05, motor->Max_Speed);
+    saveHoldingRegister(base_addr + 0x06, motor->Min_Speed);
+    saveHoldingRegister(base_addr + 0x07, motor->PID_Kp);
+    saveHoldingRegister(base_addr + 0x08, motor->PID_Ki);
+    saveHoldingRegister(base_addr + 0x09, motor->PID_Kd);
+    saveHoldingRegister(base_addr + 0x0A, motor->Max_Acc);
+    saveHoldingRegister(base_addr + 0x0B, motor->Max_Dec);
+    saveHoldingRegister(base_addr + 0x0C, motor->Status_Word);
+    saveHoldingRegister(base_addr + 0x0D, motor->Error_Code);
+    saveHoldingRegister(base_addr + 0x0E, motor->Position_Current);
+    saveHoldingRegister(base_addr + 0x0F, motor->Position_Target);
 }
 void SystemRegisters_Save(SystemRegisterMap_t* sys){
-    g_holdingRegisters[REG_DEVICE_ID] = sys->Device_ID;
-    g_holdingRegisters[REG_FIRMWARE_VERSION] = sys->Firmware_Version;
-    g_holdingRegisters[REG_SYSTEM_STATUS] = sys->System_Status;
-    g_holdingRegisters[REG_SYSTEM_ERROR] = sys->System_Error;
-    g_holdingRegisters[REG_RESET_ERROR_COMMAND] = sys->Reset_Error_Command;
-    g_holdingRegisters[REG_CONFIG_BAUDRATE] = sys->Config_Baudrate;
-    g_holdingRegisters[REG_CONFIG_PARITY] = sys->Config_Parity;
-    g_holdingRegisters[REG_CONFIG_STOP_BIT] = sys->Config_Stop_Bit;
-    g_holdingRegisters[REG_MODULE_TYPE] = sys->Module_Type;
-    g_holdingRegisters[REG_HARDWARE_VERSION] = sys->Hardware_Version;
+    saveHoldingRegister(REG_DEVICE_ID, sys->Device_ID);
+    saveHoldingRegister(REG_FIRMWARE_VERSION, sys->Firmware_Version);
+    saveHoldingRegister(REG_SYSTEM_STATUS, sys->System_Status);
+    saveHoldingRegister(REG_SYSTEM_ERROR, sys->System_Error);
+    saveHoldingRegister(REG_RESET_ERROR_COMMAND, sys->Reset_Error_Command);
+    saveHoldingRegister(REG_CONFIG_BAUDRATE, sys->Config_Baudrate);
+    saveHoldingRegister(REG_CONFIG_PARITY, sys->Config_Parity);
+    saveHoldingRegister(REG_CONFIG_STOP_BIT, sys->Config_Stop_Bit);
+    saveHoldingRegister(REG_MODULE_TYPE, sys->Module_Type);
+    saveHoldingRegister(REG_HARDWARE_VERSION, sys->Hardware_Version);
 }
 
 // Xử lý logic điều khiển motor
@@ -109,19 +109,20 @@ void Motor_ProcessControl(MotorRegisterMap_t* motor){
     uint8_t motor_id = (motor == &motor1) ? 1 : 2;
     PIDState_t* pid_state = (motor_id == 1) ? &pid_state1 : &pid_state2;
     
+    uint8_t duty = 0;
     if(motor->Enable == 1){
         switch(motor->Control_Mode){
             case CONTROL_MODE_ONOFF:
-                Motor_HandleOnOff(motor);
+                duty = Motor_HandleOnOff(motor);
                 break;
             case CONTROL_MODE_PID:
-                Motor_HandlePID(motor);
+                duty = Motor_HandlePID(motor);
                 break;
             case CONTROL_MODE_POSITION:
-                Motor_HandlePosition(motor);
+                duty = Motor_HandlePosition(motor);
                 break;
             case CONTROL_MODE_CALIB:
-                Motor_HandleCalib(motor);
+                duty = Motor_HandleCalib(motor);
                 break;
             default:
                 break;
@@ -129,11 +130,11 @@ void Motor_ProcessControl(MotorRegisterMap_t* motor){
     }
     else if(motor->Enable == 0){
         motor->Status_Word = 0x0000;
-        g_holdingRegisters[REG_M1_STATUS_WORD] = 0x0000;
-        pid_state->integral = 0.0f;
-        pid_state->last_error = 0.0f;
-        pid_state->output = 0.0f;
-        pid_state->error = 0.0f;
+        HREG(REG_M1_STATUS_WORD) = 0x0000;
+        pid_state->integral = 0;
+        pid_state->last_error = 0;
+        pid_state->output = 0;
+        pid_state->error = 0;
         
         //motor->Direction = IDLE;
         motor->Actual_Speed = 0; // Reset actual speed when disabled       
@@ -146,11 +147,25 @@ void Motor_ProcessControl(MotorRegisterMap_t* motor){
         } 
     }
 
+    // Hồ sơ vị trí lập lại từ vị trí đo được mỗi lần vào lại Position mode
+    if (motor->Enable != 1 || motor->Control_Mode != CONTROL_MODE_POSITION) {
+        MotionProfile_t* profile = (motor_id == 1) ? &motion_profile1 : &motion_profile2;
+        profile->active = 0;
+    }
+
     if(motor == &motor1) {   
         Motor1_Set_Direction(motor->Direction); 
     } else {
         Motor2_Set_Direction(motor->Direction);
     }
+
+    // Motor có encoder: Actual_Speed luôn là tốc độ đo được (%), ở mọi mode
+    if (Encoder_HasSpeedFeedback(motor_id)) {
+        int32_t measured = q16ToInt(measuredSpeedPercent(motor_id));
+        motor->Actual_Speed = (measured > 0xFF) ? 0xFF : (uint8_t)measured;
+    }
+
+    Telemetry_Record(motor_id, pid_state, duty);
 }
 
 
@@ -240,9 +255,9 @@ uint8_t Motor_HandleOnOff(MotorRegisterMap_t* motor) {
     
     if(motor->Enable == 1 && motor->Direction != IDLE) {
         motor->Status_Word = 0x0001;
-        g_holdingRegisters[REG_M1_STATUS_WORD] = 0x0001;
+        HREG(REG_M1_STATUS_WORD) = 0x0001;
         // Xuất PWM theo tốc độ đặt
-        duty = motor->Command_Speed * 0.98;
+        duty = motor->Command_Speed * 98 / 100;
         motor->Actual_Speed = duty; // Update actual speed in ON/OFF mode
         
         // ✅ CRITICAL FIX: OUTPUT PWM WHEN ENABLED
@@ -253,7 +268,7 @@ uint8_t Motor_HandleOnOff(MotorRegisterMap_t* motor) {
         }
     } else {
         motor->Status_Word = 0x0000;
-        g_holdingRegisters[REG_M1_STATUS_WORD] = 0x0000;
+        HREG(REG_M1_STATUS_WORD) = 0x0000;
         motor->Direction = IDLE;
         motor->Actual_Speed = 0;
         duty = 0;
@@ -272,33 +287,6 @@ uint8_t Motor_HandleOnOff(MotorRegisterMap_t* motor) {
 }
 
 
-// Function to simulate actual speed measurement (replace with real encoder reading)
-uint8_t getActualSpeed(uint8_t motor_id) {
-    // For now, simulate speed based on PWM duty with some delay/filtering
-    // In real implementation, this should read from encoder or current sensor
-    static uint8_t simulated_speed1 = 0;
-    static uint8_t simulated_speed2 = 0;
-    
-    if (motor_id == 1) {
-        // Simple first-order filter to simulate motor response
-        uint8_t target_speed = motor1.Command_Speed;
-        if (simulated_speed1 < target_speed) {
-            simulated_speed1 += (target_speed > simulated_speed1 + 2) ? 2 : (target_speed - simulated_speed1);
-        } else if (simulated_speed1 > target_speed) {
-            simulated_speed1 -= (simulated_speed1 > target_speed + 2) ? 2 : (simulated_speed1 - target_speed);
-        }
-        return simulated_speed1;
-    } else {
-        uint8_t target_speed = motor2.Command_Speed;
-        if (simulated_speed2 < target_speed) {
-            simulated_speed2 += (target_speed > simulated_speed2 + 2) ? 2 : (target_speed - simulated_speed2);
-        } else if (simulated_speed2 > target_speed) {
-            simulated_speed2 -= (simulated_speed2 > target_speed + 2) ? 2 : (simulated_speed2 - target_speed);
-        }
-        return simulated_speed2;
-    }
-}
-
 // Xử lý PID mode (mode 3)
 uint8_t Motor_HandlePID(MotorRegisterMap_t* motor) {
     uint8_t motor_id = (motor == &motor1) ? 1 : 2;
@@ -307,11 +295,11 @@ uint8_t Motor_HandlePID(MotorRegisterMap_t* motor) {
     // Check enable & mode
     if (motor->Enable == 0 || motor->Control_Mode != CONTROL_MODE_PID || motor->Direction == IDLE) {
         // Reset PID state
-        pid_state->integral = 0.0f;
-        pid_state->last_error = 0.0f;
-        pid_state->output = 0.0f;
-        pid_state->error = 0.0f;
-        pid_state->simulated_output = 0.0f;
+        pid_state->integral = 0;
+        pid_state->last_error = 0;
+        pid_state->output = 0;
+        pid_state->error = 0;
+        pid_state->simulated_output = 0;
         
         // Reset actual speed when disabled
         motor->Actual_Speed = 0;
@@ -332,20 +320,25 @@ uint8_t Motor_HandlePID(MotorRegisterMap_t* motor) {
 
 
     // Update acceleration limit from motor settings
-    pid_state->acceleration_limit = (float)motor->Max_Acc;
+    pid_state->acceleration_limit = q16FromInt(motor->Max_Acc);
 
-    // Compute PID with REAL feedback
-    float output = PID_Compute(motor_id, (float)motor->Command_Speed, (float)motor->Actual_Speed);
+    // Phản hồi là tốc độ đo từ encoder. Motor không có encoder vẫn lấy output
+    // chu kỳ trước làm phản hồi như cũ (thực chất là vòng hở)
+    q16_t feedback = Encoder_HasSpeedFeedback(motor_id) ? measuredSpeedPercent(motor_id)
+                                                        : q16FromInt(motor->Actual_Speed);
+    q16_t output = PID_Compute(motor_id, q16FromInt(motor->Command_Speed), feedback);
     
-    motor->Actual_Speed = output;
+    if (!Encoder_HasSpeedFeedback(motor_id)) {
+        motor->Actual_Speed = q16ToInt(output);
+    }
 
     // Convert to PWM duty (0-100%)
-    uint8_t duty = (uint8_t)output;
+    uint8_t duty = (uint8_t)q16ToInt(output);
     
     // Clamp duty to max/min speed limits
     if (duty > motor->Max_Speed) duty = motor->Max_Speed;
     if (duty < motor->Min_Speed && duty > 0) duty = motor->Min_Speed;
-    duty = duty * 0.98;
+    duty = duty * 98 / 100;
     // Update motor outputs
     if (motor_id == 1) {
         Motor1_OutputPWM(motor, duty);
@@ -359,25 +352,19 @@ uint8_t Motor_HandlePID(MotorRegisterMap_t* motor) {
 uint8_t Motor_HandlePosition(MotorRegisterMap_t* motor){
     uint8_t motor_id = (motor == &motor1) ? 1 : 2;
     PIDState_t* pid_state = (motor_id == 1) ? &pid_state1 : &pid_state2;
+    MotionProfile_t* profile = (motor_id == 1) ? &motion_profile1 : &motion_profile2;
 
     // ✅ FIX: Chỉ kiểm tra Enable và Control_Mode, KHÔNG kiểm tra Direction
-    // Direction sẽ được tự động set dựa trên position_error ở dòng 414-430
+    // Direction được set theo dấu lệnh tốc độ bên dưới
     if (motor->Enable == 0 || motor->Control_Mode != CONTROL_MODE_POSITION) {
         // Reset PID state
-        pid_state->integral = 0.0f;
-        pid_state->last_error = 0.0f;
-        pid_state->output = 0.0f;
-        pid_state->error = 0.0f;
-        
-        // Reset acceleration limiting state (declared as static in code below)
-        // This ensures smooth start from 0 when re-enabled
-        static float previous_output1 = 0.0f;
-        static float previous_output2 = 0.0f;
-        if (motor_id == 1) {
-            previous_output1 = 0.0f;
-        } else {
-            previous_output2 = 0.0f;
-        }
+        pid_state->integral = 0;
+        pid_state->last_error = 0;
+        pid_state->output = 0;
+        pid_state->error = 0;
+
+        // Lần vào lại Position mode lập hồ sơ mới từ vị trí đo được
+        profile->active = 0;
         
         // Reset actual speed when disabled
         motor->Actual_Speed = 0;
@@ -394,21 +381,32 @@ uint8_t Motor_HandlePosition(MotorRegisterMap_t* motor){
         return 0;
     }
 
-    // Get current position from encoder (in cm)
-    uint16_t current_position = motor->Position_Current;
-    
-    // Get target position from motor registers (in cm)
-    uint16_t target_position = motor->Position_Target;
-    
-    // Calculate position error (in cm)
-    int16_t position_error = (int16_t)target_position - (int16_t)current_position;
-    
-    // Calculate absolute position error
-    uint16_t abs_position_error = (position_error > 0) ? position_error : -position_error;
-    
-    // Check if at target position (within tolerance)
-    if (abs_position_error <= 1) {
-        // At target position - stop motor
+    // Get current/target position from encoder and motor registers (in cm)
+    q16_t current_position = q16FromInt(motor->Position_Current);
+    q16_t target_position = q16FromInt(motor->Position_Target);
+    if (!profile->active) {
+        MotionProfile_Reset(profile, current_position);
+    }
+
+    // ═══════════════════════════════════════════════════════════════════════════════
+    // ✅ MOTION PROFILE - hình thang/S-curve từ vị trí hiện tại tới Position_Target
+    // ═══════════════════════════════════════════════════════════════════════════════
+    // Giới hạn theo % như các mode khác, đổi sang cm/s qua tốc độ dây ở 1%:
+    //   V = min(Command_Speed, Max_Speed), A = Max_Acc, D = Max_Dec (0 = dùng Max_Acc)
+    // Tj = Profile_Jerk_Ms (0x012C), 0 = hình thang
+    q16_t cm_per_percent = wireSpeedPerPercent();
+    uint16_t speed_limit = (motor->Command_Speed < motor->Max_Speed) ? motor->Command_Speed : motor->Max_Speed;
+    ProfileLimits_t limits;
+    limits.max_velocity = q16Saturate((int64_t)cm_per_percent * speed_limit);
+    limits.acceleration = q16Saturate((int64_t)cm_per_percent * motor->Max_Acc);
+    limits.deceleration = q16Saturate((int64_t)cm_per_percent * motor->Max_Dec);
+    limits.jerk_time = (q16_t)(((uint32_t)HREG(REG_PROFILE_JERK_MS) << Q16_SHIFT) / 1000U);
+    MotionProfile_SetTarget(profile, target_position, &limits);
+    MotionProfile_Update(profile, controlDtQ32);
+    
+    // Hồ sơ đã tới đích và sai số thật trong 1 cm - stop motor
+    if (profile->done && q16Abs(q16Sub(target_position, current_position)) <= Q16_ONE) {
+        pid_state->integral = 0;
         motor->Direction = DIRECTION_IDLE;
         motor->Actual_Speed = 0;
         if (motor_id == 1) {
@@ -420,9 +418,21 @@ uint8_t Motor_HandlePosition(MotorRegisterMap_t* motor){
         }
         return 0;
     }
+
+    // Lệnh tốc độ (%) = feedforward vận tốc tham chiếu + PID trên sai số so với vị trí tham chiếu
+    q16_t feedforward = 0;
+    if (cm_per_percent > 0) {
+        uint32_t percent_per_cm = 0xFFFFFFFFU / (uint32_t)cm_per_percent;
+        if (percent_per_cm > (uint32_t)Q16_MAX) {
+            percent_per_cm = (uint32_t)Q16_MAX;
+        }
+        feedforward = q16Mul(profile->velocity, (q16_t)percent_per_cm);
+    }
+    q16_t output = q16Add(feedforward, PID_Compute_Position(motor_id, profile->position, current_position));
+    output = q16Clamp(output, -q16FromInt(motor->Max_Speed), q16FromInt(motor->Max_Speed));
     
-    // Determine direction based on position error
-    if (position_error > 0) {
+    // Determine direction based on command sign
+    if (output > 0) {
         // Need to move forward (unroll wire)
         motor->Direction = DIRECTION_FORWARD;
         if (motor_id == 1) {
@@ -430,7 +440,7 @@ uint8_t Motor_HandlePosition(MotorRegisterMap_t* motor){
         } else {
             Motor2_Set_Direction(DIRECTION_FORWARD);
         }
-    } else if(position_error < 0){
+    } else if (output < 0) {
         // Need to move reverse (roll wire)
         motor->Direction = DIRECTION_REVERSE;
         if (motor_id == 1) {
@@ -440,52 +450,16 @@ uint8_t Motor_HandlePosition(MotorRegisterMap_t* motor){
         }
     }
     
-    // Target speed is Command_Speed (configured speed %)
-    float target_speed = (float)motor->Command_Speed;
-    
-    // Update acceleration limit from motor settings
-    pid_state->acceleration_limit = (float)motor->Max_Acc;
-
-    // Compute PID with position error as feedback
-    // PID_Compute_Position(motor_id, setpoint_cm, feedback_cm)
-    // setpoint = target position (cm), feedback = current position (cm)
-    float output = PID_Compute_Position(motor_id, (float)target_position, (float)current_position);
-    
-    // ═══════════════════════════════════════════════════════════════════════════════
-    // ✅ ACCELERATION LIMITING - Giới hạn tốc độ thay đổi output
-    // ═══════════════════════════════════════════════════════════════════════════════
-    // Prevents sudden jumps in motor speed by limiting acceleration/deceleration
-    // Max_Acc is in %/s, we need %/cycle (cycle = 10ms = 0.01s)
-    static float previous_output1 = 0.0f;
-    static float previous_output2 = 0.0f;
-    float* prev_output = (motor_id == 1) ? &previous_output1 : &previous_output2;
-    
-    // Calculate max allowed change per cycle (Max_Acc is in %/second)
-    // Sample time = 10ms = 0.01s
-    float max_delta_per_cycle = motor->Max_Acc * 0.01f;
-    
-    // Apply acceleration limiting
-    if (output > *prev_output + max_delta_per_cycle) {
-        // Acceleration too high - limit increase
-        output = *prev_output + max_delta_per_cycle;
-    } else if (output < *prev_output - max_delta_per_cycle) {
-        // Deceleration too high - limit decrease
-        output = *prev_output - max_delta_per_cycle;
-    }
-    
-    // Store current output for next cycle
-    *prev_output = output;
-    // ═══════════════════════════════════════════════════════════════════════════════
-    
-    motor->Actual_Speed = (uint8_t)output;
+    output = q16Abs(output);
+    motor->Actual_Speed = (uint8_t)q16ToInt(output);
 
     // Convert to PWM duty (0-100%)
-    uint8_t duty = (uint8_t)output;
+    uint8_t duty = (uint8_t)q16ToInt(output);
     
     // Clamp duty to max/min speed limits
     if (duty > motor->Max_Speed) duty = motor->Max_Speed;
     if (duty < motor->Min_Speed && duty > 0) duty = motor->Min_Speed;
-    duty = duty * 0.98;
+    duty = duty * 98 / 100;
     
     // Update motor outputs
     if (motor_id == 1) {
@@ -505,7 +479,7 @@ uint8_t Motor_HandleCalib(MotorRegisterMap_t* motor){
     
     if(motor->Enable == 1 && motor->Direction != IDLE) {
         motor->Status_Word = 0x0001;
-        g_holdingRegisters[REG_M1_STATUS_WORD] = 0x0001;
+        HREG(REG_M1_STATUS_WORD) = 0x0001;
         // Xuất PWM theo tốc độ đặt
         duty = motor->Command_Speed;
         // Chu trình calibration
@@ -515,7 +489,7 @@ uint8_t Motor_HandleCalib(MotorRegisterMap_t* motor){
         switch(calib_state) {
             case 0: // Bắt đầu - Di chuyển về vị trí gốc (REVERSE)
                 motor->Direction = REVERSE;
-                duty = motor->Command_Speed * 0.98;
+                duty = motor->Command_Speed * 98 / 100;
                 
                 // Kiểm tra sensor gốc
                 if(encoder1.Calib_Origin_Status == true) {
@@ -538,7 +512,7 @@ uint8_t Motor_HandleCalib(MotorRegisterMap_t* motor){
                 
             case 2: // Xả dây ra (FORWARD) theo khoảng cách calib
                 motor->Direction = FORWARD;
-                duty = motor->Command_Speed * 0.98;
+                duty = motor->Command_Speed * 98 / 100;
                 
                 // Kiểm tra đã đạt khoảng cách calib chưa
                 uint16_t current_length = Encoder_MeasureLength(&encoder1);
@@ -564,7 +538,7 @@ uint8_t Motor_HandleCalib(MotorRegisterMap_t* motor){
                 
             case 4: // Quay về vị trí gốc (REVERSE)
                 motor->Direction = REVERSE;
-                duty = motor->Command_Speed * 0.98;
+                duty = motor->Command_Speed * 98 / 100;
                 
                 // Kiểm tra sensor gốc
                 if(encoder1.Calib_Origin_Status == true) {
@@ -602,7 +576,7 @@ uint8_t Motor_HandleCalib(MotorRegisterMap_t* motor){
         }
     } else {
         motor->Status_Word = 0x0000;
-        g_holdingRegisters[REG_M1_STATUS_WORD] = 0x0000;
+        HREG(REG_M1_STATUS_WORD) = 0x0000;
         motor->Direction = IDLE;
         motor->Actual_Speed = 0;
         duty = 0;
@@ -659,203 +633,325 @@ void Motor2_OutputPWM(MotorRegisterMap_t* motor, uint8_t duty_percent){
 // Khởi tạo giá trị PID cho từng motor
 // void PID_Init(MotorRegisterMap_t* motor, float kp, float ki, float kd){
 
+// ═══════════════════════════════════════════════════════════════════════════════
+// NHỊP VÒNG ĐIỀU KHIỂN (TIM3 CC4)
+// ═══════════════════════════════════════════════════════════════════════════════
+// TIM3 đếm tự do 0..0xFFFF ở 72 MHz để phát PWM Motor 1 (CH1/CH2). CH4 không ra
+// chân nên dùng output compare của nó làm nhịp: mỗi lần match cộng tiếp CCR4,
+// không đụng tới ARR/PWM. 1 chu kỳ điều khiển (72000 tick ở 1 kHz) dài hơn 1 vòng
+// counter nên chia thành nhiều bước compare; chỉ bước cuối mới đánh thức MotorTask.
+// ═══════════════════════════════════════════════════════════════════════════════
+#define CONTROL_TICK_FLAG       0x0001U
+#define CONTROL_MAX_STEP_TICKS  0xC000U     // Chừa 1/4 vòng counter cho độ trễ ngắt
+
+static osThreadId_t controlTaskHandle = NULL;
+static volatile uint32_t controlPeriodTicks = 0;    // Tick TIM3 mỗi chu kỳ điều khiển
+static volatile uint32_t controlTicksLeft = 0;      // Tick còn lại sau mốc CCR4 đang chờ
+static volatile uint8_t controlTickPending = 0;     // ISR đã báo, MotorTask chưa nhận
+static volatile uint16_t controlOverruns = 0;
+static uint16_t controlRateHz = 0;
+static uint16_t controlJitterUs = 0;
+static uint32_t controlLastCycles = 0;
+static uint8_t controlSkipJitter = 1;               // Chu kỳ đầu / vừa đổi tần số
+static uint32_t controlDtScale = 0;                 // 2^40 / SystemCoreClock: cycle -> giây Q0.32 (<< 8)
+
+static void setControlRate(uint16_t rateHz) {
+    controlRateHz = rateHz;
+    // Clock TIM3 = PCLK1 x2 (APB1 prescaler != 1), ISR nạp giá trị mới ở chu kỳ sau
+    controlPeriodTicks = HAL_RCC_GetPCLK1Freq() * 2 / (htim3.Instance->PSC + 1) / rateHz;
+}
+
+// Bước compare kế tiếp; phần còn lại dưới 2 bước thì chia đôi để không bước nào quá ngắn
+static uint32_t nextControlStep(void) {
+    uint32_t left = controlTicksLeft;
+    uint32_t step = left;
+
+    if (left > 2 * CONTROL_MAX_STEP_TICKS) {
+        step = CONTROL_MAX_STEP_TICKS;
+    } else if (left > CONTROL_MAX_STEP_TICKS) {
+        step = left / 2;
+    }
+    controlTicksLeft = left - step;
+    return step;
+}
+
+void ControlLoop_Start(void) {
+    controlTaskHandle = osThreadGetId();
+
+    ModbusLatency_EnableCycleCounter();
+
+    setControlRate(HREG(REG_CONTROL_RATE_HZ));
+    controlDtScale = (uint32_t)((1ULL << 40) / SystemCoreClock);
+    controlDtQ32 = (uint32_t)(0x100000000ULL / controlRateHz);
+    controlDtUs = 1000000U / controlRateHz;
+    controlTicksLeft = controlPeriodTicks;
+
+    // HAL_TIM_PWM_Stop dừng cả counter khi không còn kênh nào bật CCxE - giữ CC4E
+    // để nhịp không mất lúc cả 2 kênh PWM tắt. PB1 (TIM3_CH4) là GPIO DIR_2 nên
+    // không có tín hiệu nào ra chân.
+    htim3.Instance->CCER |= TIM_CCER_CC4E;
+    htim3.Instance->CCR4 = (uint16_t)(htim3.Instance->CNT + nextControlStep());
+    __HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_CC4);
+    __HAL_TIM_ENABLE_IT(&htim3, TIM_IT_CC4);
+    __HAL_TIM_ENABLE(&htim3);   // PWM có thể chưa start lần nào
+}
+
+void ControlLoop_WaitTick(void) {
+    osThreadFlagsWait(CONTROL_TICK_FLAG, osFlagsWaitAny, osWaitForever);
+    controlTickPending = 0;
+
+    uint32_t now = DWT->CYCCNT;
+    uint32_t nominal = SystemCoreClock / controlRateHz;
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000U;
+    uint32_t elapsed = now - controlLastCycles;
+    controlLastCycles = now;
+
+    if (controlSkipJitter) {
+        // Chu kỳ đầu chưa có mốc trước; chu kỳ ngay sau khi đổi tần số vẫn dài theo tần số cũ
+        if (elapsed > 4 * nominal) {
+            elapsed = nominal;
+        }
+        controlSkipJitter = 0;
+    } else {
+        uint32_t jitterUs = ((elapsed > nominal) ? elapsed - nominal : nominal - elapsed) / cyclesPerUs;
+        if (jitterUs > controlJitterUs) {
+            controlJitterUs = (jitterUs > 0xFFFF) ? 0xFFFF : jitterUs;
+        }
+    }
+
+    // CPU bị dừng lâu (debugger...) - giới hạn dt để tích phân không nhảy vọt
+    if (elapsed > 4 * nominal) {
+        elapsed = 4 * nominal;
+    } else if (elapsed < nominal / 4) {
+        elapsed = nominal / 4;
+    }
+    controlDtQ32 = (uint32_t)(((uint64_t)elapsed * controlDtScale) >> 8);
+    controlDtUs = elapsed / cyclesPerUs;
+
+    HREG(REG_CONTROL_DT_US) = controlDtUs;
+    HREG(REG_CONTROL_JITTER_US) = controlJitterUs;
+    HREG(REG_CONTROL_OVERRUN_COUNT) = controlOverruns;
+
+    // Master đổi Control_Rate_Hz - áp dụng từ chu kỳ sau
+    if (HREG(REG_CONTROL_RATE_HZ) != controlRateHz) {
+        setControlRate(HREG(REG_CONTROL_RATE_HZ));
+        controlSkipJitter = 1;
+    }
+}
+
+void ControlLoop_ResetStats(void) {
+    controlOverruns = 0;
+    controlJitterUs = 0;
+}
+
+void handleControlTickInterrupt(void) {
+    if (__HAL_TIM_GET_FLAG(&htim3, TIM_FLAG_CC4) == RESET ||
+        __HAL_TIM_GET_IT_SOURCE(&htim3, TIM_IT_CC4) == RESET) {
+        return;
+    }
+    __HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_CC4);
+
+    if (controlTicksLeft == 0) {
+        controlTicksLeft = controlPeriodTicks;
+        if (controlTickPending) {
+            // MotorTask chưa nhận tick trước (chu kỳ chạy quá 1 period) - bỏ tick này
+            controlOverruns++;
+        } else {
+            controlTickPending = 1;
+            osThreadFlagsSet(controlTaskHandle, CONTROL_TICK_FLAG);
+        }
+    }
+    htim3.Instance->CCR4 = (uint16_t)(htim3.Instance->CCR4 + nextControlStep());
+}
+
+// Hằng số thời gian lọc D: alpha = dt / (tau + dt) = 0.1 ở chu kỳ 10ms cũ
+#define PID_D_FILTER_TAU_US     90000U
+
+// Anti-windup của PID vị trí (cm × s)
+#define PID_POSITION_MAX_INTEGRAL   Q16_FROM_INT(50)
+
+// Đo số cycle của 1 lần PID_Compute/PID_Compute_Position (0x0128/0x0129)
+static void recordPIDCycles(uint32_t startCycles) {
+    uint32_t cycles = DWT->CYCCNT - startCycles;
+    if (cycles > 0xFFFF) {
+        cycles = 0xFFFF;
+    }
+    HREG(REG_PID_CYCLES) = cycles;
+    if (cycles > HREG(REG_PID_CYCLES_MAX)) {
+        HREG(REG_PID_CYCLES_MAX) = cycles;
+    }
+}
+
+// Gain ×100 -> Q16.16, chỉ tính lại khi PID_Kp/Ki/Kd đổi
+static void updatePIDGains(PIDState_t* pid_state, const MotorRegisterMap_t* motor) {
+    if (pid_state->gains_valid && pid_state->kp_raw == motor->PID_Kp &&
+        pid_state->ki_raw == motor->PID_Ki && pid_state->kd_raw == motor->PID_Kd) {
+        return;
+    }
+    pid_state->kp_raw = motor->PID_Kp;
+    pid_state->ki_raw = motor->PID_Ki;
+    pid_state->kd_raw = motor->PID_Kd;
+    pid_state->kp = q16FromInt(motor->PID_Kp) / 100;
+    pid_state->ki = q16FromInt(motor->PID_Ki) / 100;
+    pid_state->kd = q16FromInt(motor->PID_Kd) / 100;
+
+    // Anti-windup PID tốc độ: |integral| <= max_output / ki
+    if (pid_state->ki != 0) {
+        pid_state->integral_limit = q16Saturate(((int64_t)pid_state->max_output << Q16_SHIFT) / pid_state->ki);
+    } else {
+        pid_state->integral_limit = pid_state->max_integral;
+    }
+    pid_state->gains_valid = 1;
+}
+
+// D đã lọc thông thấp: f += alpha × (de/dt - f) = f - alpha × f + de / (tau + dt).
+// Nhân de với 1/(tau + dt) (~11/s) thay vì chia cho dt để de/dt không bão hòa Q16.16.
+static q16_t filterDerivative(q16_t filtered, q16_t delta_error) {
+    q16_t gain = (q16_t)(((1000000UL << 11) / (PID_D_FILTER_TAU_US + controlDtUs)) << 5);
+    q16_t alpha = q16MulQ32(gain, controlDtQ32);
+    return q16Add(q16Sub(filtered, q16Mul(alpha, filtered)), q16Mul(gain, delta_error));
+}
+
 // Khởi tạo giá trị PID cho từng motor
-void PID_Init(uint8_t motor_id, float kp, float ki, float kd) {
+void PID_Init(uint8_t motor_id, uint8_t kp, uint8_t ki, uint8_t kd) {
     PIDState_t* pid_state = (motor_id == 1) ? &pid_state1 : &pid_state2;
     
     // Reset all state variables
-    pid_state->integral = 0.0f;
-    pid_state->last_error = 0.0f;
-    pid_state->output = 0.0f;
-    pid_state->error = 0.0f;
+    pid_state->integral = 0;
+    pid_state->last_error = 0;
+    pid_state->output = 0;
+    pid_state->error = 0;
     
     // Set limits
-    pid_state->max_integral = 1000.0f;  // Anti-windup limit
-    pid_state->acceleration_limit = 10.0f;  // Limit rate of change
-    pid_state->max_output = 100.0f;  // Maximum PWM duty cycle
+    pid_state->max_integral = q16FromInt(1000);  // Anti-windup limit
+    pid_state->acceleration_limit = q16FromInt(10);  // Limit rate of change
+    pid_state->max_output = q16FromInt(100);  // Maximum PWM duty cycle
     
     // Set PID gains
     MotorRegisterMap_t* motor = (motor_id == 1) ? &motor1 : &motor2;
     motor->PID_Kp = kp;
     motor->PID_Ki = ki;
     motor->PID_Kd = kd;
+    pid_state->gains_valid = 0;
+    updatePIDGains(pid_state, motor);
 }
 
 // Tính toán PID mỗi chu kỳ - trả về duty % (0-100)
-float PID_Compute(uint8_t motor_id, float setpoint, float feedback) {
+q16_t PID_Compute(uint8_t motor_id, q16_t setpoint, q16_t feedback) {
+    uint32_t startCycles = DWT->CYCCNT;
+
     // Get correct motor and PID state
     MotorRegisterMap_t* motor = (motor_id == 1) ? &motor1 : &motor2;
     PIDState_t* pid_state = (motor_id == 1) ? &pid_state1 : &pid_state2;
     
-    // Get sample time in seconds (motor task runs every 10ms)
-    const float SAMPLE_TIME = 0.01f; // 10ms = 0.01s
-    
     // Calculate error
-    pid_state->error = setpoint - feedback;
+    pid_state->setpoint = setpoint;
+    pid_state->feedback = feedback;
+    pid_state->error = q16Sub(setpoint, feedback);
     
-    // ✅ CRITICAL FIX: Scale PID gains properly (×100 according to modbus_map.md)
-    float kp = (float)motor->PID_Kp / 100.0f;  // Scale down from ×100
-    float ki = (float)motor->PID_Ki / 100.0f;  // Scale down from ×100  
-    float kd = (float)motor->PID_Kd / 100.0f;  // Scale down from ×100
+    // Gain ×100 theo modbus_map.md, đã scale sẵn khi thanh ghi đổi
+    updatePIDGains(pid_state, motor);
     
     // Proportional term
-    float p_term = kp * pid_state->error;
+    q16_t p_term = q16Mul(pid_state->kp, pid_state->error);
     
-    // Integral term with proper time scaling and anti-windup
-    pid_state->integral += pid_state->error * SAMPLE_TIME;
+    // Integral term with proper time scaling (dt đo được, ControlLoop_WaitTick) and anti-windup
+    pid_state->integral = q16Add(pid_state->integral, q16MulQ32(pid_state->error, controlDtQ32));
+    pid_state->integral = q16Clamp(pid_state->integral, -pid_state->integral_limit, pid_state->integral_limit);
+    q16_t i_term = q16Mul(pid_state->ki, pid_state->integral);
     
-    // Anti-windup: limit integral based on max output
-    float max_integral = (ki != 0) ? (pid_state->max_output / ki) : pid_state->max_integral;
-    if (pid_state->integral > max_integral) {
-        pid_state->integral = max_integral;
-    } else if (pid_state->integral < -max_integral) {
-        pid_state->integral = -max_integral;
-    }
-    float i_term = ki * pid_state->integral;
-    
-    // Derivative term with proper time scaling
-    float derivative = (pid_state->error - pid_state->last_error) / SAMPLE_TIME;
-    
-    // Simple derivative filter to reduce noise
-    static float filtered_derivative1 = 0;
-    static float filtered_derivative2 = 0;
-    float* filtered_d = (motor_id == 1) ? &filtered_derivative1 : &filtered_derivative2;
-    
-    const float FILTER_ALPHA = 0.1f; // Low-pass filter coefficient
-    *filtered_d = (FILTER_ALPHA * derivative) + ((1.0f - FILTER_ALPHA) * (*filtered_d));
+    // Derivative term with simple low-pass filter to reduce noise
+    static q16_t filtered_derivative1 = 0;
+    static q16_t filtered_derivative2 = 0;
+    q16_t* filtered_d = (motor_id == 1) ? &filtered_derivative1 : &filtered_derivative2;
+    *filtered_d = filterDerivative(*filtered_d, q16Sub(pid_state->error, pid_state->last_error));
     
-    float d_term = kd * (*filtered_d);
+    q16_t d_term = q16Mul(pid_state->kd, *filtered_d);
     pid_state->last_error = pid_state->error;
+    pid_state->p_term = p_term;
+    pid_state->i_term = i_term;
+    pid_state->d_term = d_term;
     
     // Calculate raw output
-    float raw_output = p_term + i_term + d_term;
+    q16_t raw_output = q16Add(q16Add(p_term, i_term), d_term);
     
     // Apply rate limiting (acceleration limit per second)
-    float max_rate_change = pid_state->acceleration_limit * SAMPLE_TIME;
-    float output_change = raw_output - pid_state->output;
-    if (output_change > max_rate_change) {
-        raw_output = pid_state->output + max_rate_change;
-    } else if (output_change < -max_rate_change) {
-        raw_output = pid_state->output - max_rate_change;
-    }
+    q16_t max_rate_change = q16MulQ32(pid_state->acceleration_limit, controlDtQ32);
+    raw_output = q16Clamp(raw_output, q16Sub(pid_state->output, max_rate_change), q16Add(pid_state->output, max_rate_change));
     
     // Apply output limits (0-100%)
-    if (raw_output > pid_state->max_output) {
-        raw_output = pid_state->max_output;
-    } else if (raw_output < 0.0f) {
-        raw_output = 0.0f;
-    }
+    raw_output = q16Clamp(raw_output, 0, pid_state->max_output);
     
     // Update and return output
     pid_state->output = raw_output;
+    recordPIDCycles(startCycles);
     return raw_output;
 }
 
-float PID_Compute_Position(uint8_t motor_id, float setpoint_cm, float feedback_cm){
+q16_t PID_Compute_Position(uint8_t motor_id, q16_t setpoint_cm, q16_t feedback_cm){
     // ═══════════════════════════════════════════════════════════════════════════════
     // POSITION CONTROL PID
     // ═══════════════════════════════════════════════════════════════════════════════
-    // Input:  setpoint_cm = target position (cm), feedback_cm = current position (cm)
-    // Output: motor speed (0-100%)
+    // Input:  setpoint_cm = vị trí tham chiếu của motion profile (cm), feedback_cm = current position (cm)
+    // Output: hiệu chỉnh tốc độ có dấu (±Max_Speed %), cộng vào feedforward vận tốc
     // 
-    // PID calculates speed based on position error:
-    // - Large error → high speed (up to Command_Speed)
-    // - Small error → low speed (proportional slowdown)
-    // - At target → speed = 0
+    // Profile đã lo tăng/giảm tốc, PID chỉ bám sai lệch so với tham chiếu:
+    // - Chậm hơn tham chiếu → output dương (FORWARD)
+    // - Vượt tham chiếu → output âm (REVERSE)
     // ═══════════════════════════════════════════════════════════════════════════════
+    uint32_t startCycles = DWT->CYCCNT;
     
     // Get correct motor and PID state
     MotorRegisterMap_t* motor = (motor_id == 1) ? &motor1 : &motor2;
     PIDState_t* pid_state = (motor_id == 1) ? &pid_state1 : &pid_state2;
     
-    // Get sample time in seconds (motor task runs every 10ms)
-    const float SAMPLE_TIME = 0.01f; // 10ms = 0.01s
-    
     // Calculate position error (cm)
-    float position_error_cm = setpoint_cm - feedback_cm;
+    q16_t position_error_cm = q16Sub(setpoint_cm, feedback_cm);
+    pid_state->setpoint = setpoint_cm;
+    pid_state->feedback = feedback_cm;
     pid_state->error = position_error_cm;
     
-    // Get absolute error for speed calculation
-    float abs_error = (position_error_cm > 0) ? position_error_cm : -position_error_cm;
-    
-    // ✅ Scale PID gains properly (×100 according to modbus_map.md)
-    float kp = (float)motor->PID_Kp / 100.0f;  // Scale down from ×100
-    float ki = (float)motor->PID_Ki / 100.0f;  // Scale down from ×100  
-    float kd = (float)motor->PID_Kd / 100.0f;  // Scale down from ×100
-    
-    // Get target speed from Command_Speed (%)
-    float max_speed = (float)motor->Command_Speed;
+    // Gain ×100 theo modbus_map.md, đã scale sẵn khi thanh ghi đổi
+    updatePIDGains(pid_state, motor);
     
     // ───────────────────────────────────────────────────────────────────────────
-    // PROPORTIONAL TERM: Speed proportional to position error
+    // PROPORTIONAL TERM: hiệu chỉnh tỉ lệ với sai lệch so với tham chiếu
     // ───────────────────────────────────────────────────────────────────────────
-    // When error is large, speed approaches max_speed
-    // When error is small, speed decreases proportionally
-    float p_term = kp * abs_error;
+    q16_t p_term = q16Mul(pid_state->kp, position_error_cm);
     
     // ───────────────────────────────────────────────────────────────────────────
     // INTEGRAL TERM: Eliminate steady-state error
     // ───────────────────────────────────────────────────────────────────────────
-    pid_state->integral += position_error_cm * SAMPLE_TIME;
+    pid_state->integral = q16Add(pid_state->integral, q16MulQ32(position_error_cm, controlDtQ32));
     
     // Anti-windup: limit integral
-    float max_integral = 50.0f;  // Limit integral contribution
-    if (pid_state->integral > max_integral) {
-        pid_state->integral = max_integral;
-    } else if (pid_state->integral < -max_integral) {
-        pid_state->integral = -max_integral;
-    }
-    float i_term = ki * pid_state->integral;
+    pid_state->integral = q16Clamp(pid_state->integral, -PID_POSITION_MAX_INTEGRAL, PID_POSITION_MAX_INTEGRAL);
+    q16_t i_term = q16Mul(pid_state->ki, pid_state->integral);
     
     // ───────────────────────────────────────────────────────────────────────────
-    // DERIVATIVE TERM: Damping, reduce overshoot
+    // DERIVATIVE TERM: Damping, reduce overshoot (low-pass filtered)
     // ───────────────────────────────────────────────────────────────────────────
-    float derivative = (position_error_cm - pid_state->last_error) / SAMPLE_TIME;
-    
-    // Low-pass filter for derivative (reduce noise)
-    static float filtered_derivative1 = 0;
-    static float filtered_derivative2 = 0;
-    float* filtered_d = (motor_id == 1) ? &filtered_derivative1 : &filtered_derivative2;
+    static q16_t filtered_derivative1 = 0;
+    static q16_t filtered_derivative2 = 0;
+    q16_t* filtered_d = (motor_id == 1) ? &filtered_derivative1 : &filtered_derivative2;
+    *filtered_d = filterDerivative(*filtered_d, q16Sub(position_error_cm, pid_state->last_error));
     
-    const float FILTER_ALPHA = 0.1f;
-    *filtered_d = (FILTER_ALPHA * derivative) + ((1.0f - FILTER_ALPHA) * (*filtered_d));
-    
-    float d_term = kd * (*filtered_d);
+    q16_t d_term = q16Mul(pid_state->kd, *filtered_d);
     pid_state->last_error = position_error_cm;
+    pid_state->p_term = p_term;
+    pid_state->i_term = i_term;
+    pid_state->d_term = d_term;
     
     // ───────────────────────────────────────────────────────────────────────────
-    // CALCULATE OUTPUT SPEED (0-100%)
+    // CALCULATE OUTPUT SPEED CORRECTION (±Max_Speed %)
     // ───────────────────────────────────────────────────────────────────────────
-    float raw_output = p_term + i_term + d_term;
-    
-    // Clamp to max speed (Command_Speed)
-    if (raw_output > max_speed) {
-        raw_output = max_speed;
-    }
-    
-    // Clamp to motor limits
-    if (raw_output > motor->Max_Speed) {
-        raw_output = motor->Max_Speed;
-    }
-    
-    // Apply minimum speed threshold
-    if (raw_output > 0 && raw_output < motor->Min_Speed) {
-        raw_output = motor->Min_Speed;
-    }
-    
-    // Stop if very close to target (within 1cm)
-    if (abs_error <= 1.0f) {
-        raw_output = 0.0f;
-        pid_state->integral = 0.0f;  // Reset integral when stopped
-    }
-    
-    // Ensure non-negative output
-    if (raw_output < 0.0f) {
-        raw_output = 0.0f;
-    }
+    q16_t raw_output = q16Add(q16Add(p_term, i_term), d_term);
+    q16_t max_speed = q16FromInt(motor->Max_Speed);
+    raw_output = q16Clamp(raw_output, -max_speed, max_speed);
     
     // Update and return output
     pid_state->output = raw_output;
+    recordPIDCycles(startCycles);
     return raw_output;
 }
 void Motor_UpdatePosition(MotorRegisterMap_t* motor){
@@ -888,17 +984,17 @@ void PID_DebugPrint(uint8_t motor_id) {
     // You can read these via Modbus to monitor PID performance
     if (motor_id == 1) {
         // Use some unused registers for debug (example addresses)
-        g_holdingRegisters[0x00E0] = (uint16_t)(pid_state->error * 10);       // Error x10
-        g_holdingRegisters[0x00E1] = (uint16_t)(pid_state->integral * 10);    // Integral x10  
-        g_holdingRegisters[0x00E2] = (uint16_t)(pid_state->output);           // PID Output
-        g_holdingRegisters[0x00E3] = motor->Command_Speed;                    // Setpoint
-        g_holdingRegisters[0x00E4] = motor->Actual_Speed;                     // Feedback
+        HREG(0x00E0) = (uint16_t)q16ToInt16Scaled(pid_state->error, 10);       // Error x10
+        HREG(0x00E1) = (uint16_t)q16ToInt16Scaled(pid_state->integral, 10);    // Integral x10  
+        HREG(0x00E2) = (uint16_t)q16ToInt(pid_state->output);           // PID Output
+        HREG(0x00E3) = motor->Command_Speed;                    // Setpoint
+        HREG(0x00E4) = motor->Actual_Speed;                     // Feedback
     } else {
-        g_holdingRegisters[0x00E5] = (uint16_t)(pid_state->error * 10);       // Error x10
-        g_holdingRegisters[0x00E6] = (uint16_t)(pid_state->integral * 10);    // Integral x10
-        g_holdingRegisters[0x00E7] = (uint16_t)(pid_state->output);           // PID Output  
-        g_holdingRegisters[0x00E8] = motor->Command_Speed;                    // Setpoint
-        g_holdingRegisters[0x00E9] = motor->Actual_Speed;                     // Feedback
+        HREG(0x00E5) = (uint16_t)q16ToInt16Scaled(pid_state->error, 10);       // Error x10
+        HREG(0x00E6) = (uint16_t)q16ToInt16Scaled(pid_state->integral, 10);    // Integral x10
+        HREG(0x00E7) = (uint16_t)q16ToInt(pid_state->output);           // PID Output  
+        HREG(0x00E8) = motor->Command_Speed;                    // Setpoint
+        HREG(0x00E9) = motor->Actual_Speed;                     // Feedback
     }
 }
 void System_ResetSystem(void){
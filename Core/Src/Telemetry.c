@@ -0,0 +1,117 @@
+#include "Telemetry.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+#include "Encoder.h"
+#include "stm32f1xx_hal.h"
+
+typedef struct {
+    uint16_t seq;
+    uint32_t timestampUs;
+    int16_t setpoint;       // x10
+    int16_t feedback;       // x10
+    int16_t pTerm;          // x100 (% duty)
+    int16_t iTerm;
+    int16_t dTerm;
+    uint16_t duty;
+    uint16_t encoderCount;
+} TelemetrySample_t;
+
+static TelemetrySample_t ring[TELEMETRY_RING_SIZE];
+static volatile uint16_t ringHead = 0;      // Chỉ MotorTask ghi
+static volatile uint16_t ringTail = 0;      // Chỉ UartTask ghi
+
+// Trạng thái riêng của producer
+static uint16_t sampleSeq = 0;              // Tăng cả khi sample bị bỏ -> master thấy khoảng trống
+static volatile uint16_t droppedCount = 0;
+static uint16_t decimationCount = 0;
+static uint32_t timestampUs = 0;
+static uint32_t lastCycles = 0;
+
+// Timestamp µs 32 bit liên tục (CYCCNT chỉ đủ ~59 s ở 72 MHz); DWT đã bật ở ModbusLatency_Init
+static uint32_t updateTimestamp(void) {
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000U;
+    uint32_t elapsedUs = (DWT->CYCCNT - lastCycles) / cyclesPerUs;
+    lastCycles += elapsedUs * cyclesPerUs;
+    timestampUs += elapsedUs;
+    return timestampUs;
+}
+
+void Telemetry_Record(uint8_t motorId, const PIDState_t *pid, uint8_t duty) {
+    if (HREG(REG_TELEMETRY_MOTOR) != motorId) {
+        return;
+    }
+    uint32_t now = updateTimestamp();
+    if (++decimationCount < HREG(REG_TELEMETRY_DECIMATION)) {
+        return;
+    }
+    decimationCount = 0;
+
+    uint16_t seq = sampleSeq++;
+    uint16_t head = ringHead;
+    if ((uint16_t)(head - ringTail) >= TELEMETRY_RING_SIZE) {
+        droppedCount++;
+        return;
+    }
+
+    TelemetrySample_t *s = &ring[head & (TELEMETRY_RING_SIZE - 1)];
+    s->seq = seq;
+    s->timestampUs = now;
+    s->setpoint = q16ToInt16Scaled(pid->setpoint, 10);
+    s->feedback = q16ToInt16Scaled(pid->feedback, 10);
+    s->pTerm = q16ToInt16Scaled(pid->p_term, 100);
+    s->iTerm = q16ToInt16Scaled(pid->i_term, 100);
+    s->dTerm = q16ToInt16Scaled(pid->d_term, 100);
+    s->duty = duty;
+    s->encoderCount = Encoder_HasSpeedFeedback(motorId) ? encoder1.Encoder_Count : 0;    // Encoder chỉ gắn ở motor 1
+
+    // Sample phải nằm trong RAM trước khi consumer thấy head mới
+    __DMB();
+    ringHead = head + 1;
+}
+
+static uint8_t *putU16(uint8_t *p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+    return p + 2;
+}
+
+// Chép tối đa maxSamples sample (big-endian) vào dest, trả về số sample đã chép
+uint8_t Telemetry_Drain(uint8_t *dest, uint8_t maxSamples) {
+    uint16_t tail = ringTail;
+    uint16_t available = ringHead - tail;
+    uint8_t count = (available < maxSamples) ? available : maxSamples;
+
+    __DMB();
+    for (uint8_t i = 0; i < count; i++) {
+        const TelemetrySample_t *s = &ring[(tail + i) & (TELEMETRY_RING_SIZE - 1)];
+        dest = putU16(dest, s->seq);
+        dest = putU16(dest, s->timestampUs >> 16);
+        dest = putU16(dest, s->timestampUs & 0xFFFF);
+        dest = putU16(dest, (uint16_t)s->setpoint);
+        dest = putU16(dest, (uint16_t)s->feedback);
+        dest = putU16(dest, (uint16_t)s->pTerm);
+        dest = putU16(dest, (uint16_t)s->iTerm);
+        dest = putU16(dest, (uint16_t)s->dTerm);
+        dest = putU16(dest, s->duty);
+        dest = putU16(dest, s->encoderCount);
+    }
+    // Đọc xong slot rồi mới trả lại cho producer
+    __DMB();
+    ringTail = tail + count;
+    return count;
+}
+
+uint16_t Telemetry_Pending(void) {
+    return (uint16_t)(ringHead - ringTail);
+}
+
+// Bỏ mọi sample đang chờ (consumer dời tail tới head)
+void Telemetry_Flush(void) {
+    ringTail = ringHead;
+}
+
+// Gọi từ UartTask
+void Telemetry_UpdateRegisters(void) {
+    HREG(REG_TELEMETRY_PENDING) = Telemetry_Pending();
+    HREG(REG_TELEMETRY_DROPPED) = droppedCount;
+}
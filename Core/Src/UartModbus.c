@@ -3,6 +3,10 @@
 #include "stm32f1xx_it.h"
 #include "main.h"
 #include "ModbusMap.h"
+#include "DOutput.h"
+#include "ModbusLatency.h"
+#include "Telemetry.h"
+#include "MotorControl.h"
 #include "cmsis_os.h"
 #include <string.h>
 
@@ -11,15 +15,195 @@ osMutexId_t modbusTxMutex;
 
 // Buffer đơn giản cho việc nhận dữ liệu
 uint8_t rxBuffer[RX_BUFFER_SIZE];
-uint8_t rxIndex = 0;
+uint16_t rxIndex = 0;
 uint8_t frameReceived = 0;
 uint32_t g_lastUARTActivity = 0;
 
-// Single byte buffer for UART reception
-static uint8_t rxByte = 0;
+// Circular DMA buffer cho USART2 RX - frame được tách bằng ngắt IDLE line
+static uint8_t rxDmaBuffer[RX_DMA_BUFFER_SIZE];
+static uint16_t rxDmaReadPos = 0;
+// CRC tính trong ISR T3.5, cùng vòng copy frame ra khỏi buffer DMA (O(n) / frame)
+// - bằng MODBUS_CRC_RESIDUE nếu frame đúng
+static uint16_t rxFrameCRC = MODBUS_CRC_INIT;
+// Vị trí DMA tại ngắt IDLE gần nhất - frame kết thúc ở đây nếu im lặng đủ T3.5
+static volatile uint16_t rxIdleWritePos = 0;
+
+// Task xử lý Modbus - được đánh thức bằng thread flag khi có frame
+static osThreadId_t modbusTaskHandle = NULL;
+
+// Arm/trigger: giá trị ghi vào block motor khi đang ARM được giữ ở đây
+static uint16_t syncStaged[SYNC_STAGED_COUNT];
+static uint32_t syncStagedMask = 0;
+
+// Bit = 1: thanh ghi đã được master ghi nhưng task sở hữu chưa load lại
+static uint32_t dirtyBitmap[DIRTY_BITMAP_WORDS];
+
+// Process image: MotorTask ghi vào buffer không active rồi đổi processImageSeq,
+// FC3/FC23 đọc buffer active - không task nào phải chờ task nào
+typedef struct {
+    uint32_t cycle;
+    uint16_t regs[PROCESS_IMAGE_COUNT];
+    uint16_t fastPoll[FAST_POLL_COUNT];     // 0x00F0-0x00FF, chép theo bảng map 0x00D0
+} ProcessImage_t;
+static ProcessImage_t processImage[2];
+static volatile uint32_t processImageSeq = 0;   // Buffer active = processImageSeq & 1
+// Thanh ghi master đã ghi sau snapshot gần nhất - đọc từ thanh ghi live
+static uint32_t writtenSinceSnapshot[(PROCESS_IMAGE_COUNT + 31) / 32];
+
+// Auto-baud: TIM2_CH4 capture cạnh xuống trên PA3 (chân USART2_RX)
+static volatile uint8_t autoBaudActive = 0;
+static volatile uint8_t autoBaudDone = 0;
+static volatile uint8_t autoBaudRelock = 0;
+static uint8_t autoBaudEdges = 0;
+static uint16_t autoBaudLastCapture = 0;
+static uint32_t autoBaudLastCycles = 0;
+static uint16_t autoBaudMinTicks = 0xFFFF;
+static uint8_t autoBaudFramingErrors = 0;
+
+// Cấu hình UART đang chạy (current_baudrate khai báo trong main.c) và cấu hình trước đó để revert
+static uint8_t currentParity = DEFAULT_CONFIG_PARITY;
+static uint8_t currentStopBit = DEFAULT_CONFIG_STOP_BIT;
+static uint16_t previousSerialConfig[3];
+static uint32_t serialTrialDeadline = 0;
+
+// Config_Baudrate code -> baud (code 0 = auto)
+static const uint32_t baudrateTable[BAUDRATE_CODE_MAX + 1] = {
+    0, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600
+};
+
+// FC08 sub-function 0x0A xóa counter bằng cách lưu mốc - các counter g_ vẫn chạy liên tục
+typedef struct {
+    uint32_t busMessage;
+    uint32_t busCommError;
+    uint32_t exception;
+    uint32_t slaveMessage;
+    uint32_t slaveNoResponse;
+    uint32_t charOverrun;
+} DiagBaseline_t;
+static DiagBaseline_t diagBaseline;
+
+// Buffer response tĩnh cho DMA TX (không nằm trên stack của UartTask)
+static uint8_t txBuffer[TX_BUFFER_SIZE];
+static volatile uint8_t txBusy = 0;
+// TIM4 đang đếm RS485_Post_Guard_us thay cho T1.5/T3.5 - DE chưa nhả
+static volatile uint8_t txPostGuardActive = 0;
+// ARR của TIM4 cho mốc T3.5, nạp lại sau post guard
+static uint16_t frameTimerReload = 0;
+
+// Bộ nhớ thanh ghi: chỉ các page đã map. Page 0x000-0x004 đứng đầu và liền nhau
+// để process image chép 0x0000-0x004F bằng 1 memcpy.
+enum {
+    SLOT_MOTOR1,        // 0x0000
+    SLOT_MOTOR2,        // 0x0010
+    SLOT_DI,            // 0x0020
+    SLOT_DO,            // 0x0030
+    SLOT_ENCODER,       // 0x0040
+    SLOT_FAST_POLL_MAP, // 0x00D0
+    SLOT_PID_DEBUG,     // 0x00E0
+    SLOT_FAST_POLL,     // 0x00F0
+    SLOT_SYSTEM,        // 0x0100
+    SLOT_COMM,          // 0x0110
+    SLOT_TELEMETRY,     // 0x0120
+    SLOT_LATENCY,       // 0x0130
+    SLOT_COUNT
+};
+static uint16_t holdingStorage[SLOT_COUNT][HOLDING_PAGE_SIZE];
+
+#define NO_LIMIT    { 0, 0xFFFF }
+
+static const RegisterLimit_t motorLimits[HOLDING_PAGE_SIZE] = {
+    { CONTROL_MODE_ONOFF, CONTROL_MODE_CALIB },     // Control_Mode
+    { 0, 1 },                                       // Enable
+    { 0, 100 },                                     // Command_Speed (%)
+    NO_LIMIT,                                       // Actual_Speed (R)
+    { DIRECTION_IDLE, DIRECTION_REVERSE },          // Direction
+    { 0, 100 }, { 0, 100 },                         // Max_Speed / Min_Speed (%)
+    { 0, 255 }, { 0, 255 }, { 0, 255 },             // PID_Kp / Ki / Kd (×100, uint8_t)
+    { 0, 255 }, { 0, 255 },                         // Max_Acc / Max_Dec (uint8_t)
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t diLimits[HOLDING_PAGE_SIZE] = {
+    NO_LIMIT,
+    { DIO_ASSIGN_NONE, DIO_ASSIGN_JOG_MODE }, { DIO_ASSIGN_NONE, DIO_ASSIGN_JOG_MODE },
+    { DIO_ASSIGN_NONE, DIO_ASSIGN_JOG_MODE }, { DIO_ASSIGN_NONE, DIO_ASSIGN_JOG_MODE },
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t doLimits[HOLDING_PAGE_SIZE] = {
+    NO_LIMIT,
+    { 0, 1 }, { DIO_ASSIGN_NONE, DIO_ASSIGN_JOG_MODE },     // DO1 Control / Assignment
+    { 0, 1 }, { DIO_ASSIGN_NONE, DIO_ASSIGN_JOG_MODE },     // DO2 Control / Assignment
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t encoderLimits[HOLDING_PAGE_SIZE] = {
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    { 0, 1 },                                       // Encoder_Reset
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t systemLimits[HOLDING_PAGE_SIZE] = {
+    { 1, 247 },                                     // Device_ID
+    { BAUDRATE_CODE_AUTO, BAUDRATE_CODE_MAX },      // Config_Baudrate
+    { PARITY_NONE, PARITY_ODD },                    // Config_Parity
+    { 1, 2 },                                       // Config_Stop_Bit
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    { 0, 1 }, { 0, 1 }, { 0, 1 },                   // Reset_Error / Sync_Arm / Sync_Trigger
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t commLimits[HOLDING_PAGE_SIZE] = {
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    NO_LIMIT, NO_LIMIT,
+    { 0, RS485_MAX_PRE_GUARD_US },                  // RS485_Pre_Guard_us
+    { 0, RS485_MAX_POST_GUARD_US },                 // RS485_Post_Guard_us
+    { RS485_DE_DISABLED, RS485_DE_ACTIVE_LOW },     // RS485_DE_Mode
+    NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t telemetryLimits[HOLDING_PAGE_SIZE] = {
+    { 0, 2 },                                       // Telemetry_Motor
+    { 1, 1000 },                                    // Telemetry_Decimation
+    NO_LIMIT, NO_LIMIT,
+    { CONTROL_RATE_MIN_HZ, CONTROL_RATE_MAX_HZ },   // Control_Rate_Hz
+    NO_LIMIT, NO_LIMIT,
+    { 0, 0 },                                       // Control_Overrun_Count (chỉ ghi 0)
+    NO_LIMIT,
+    { 0, 0 },                                       // PID_Cycles_Max (chỉ ghi 0)
+    NO_LIMIT,
+    { 1, RATED_SPEED_MAX_RPM },                     // Rated_Speed_RPM
+    { 0, PROFILE_MAX_JERK_MS },                     // Profile_Jerk_Ms
+    NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+static const RegisterLimit_t latencyLimits[HOLDING_PAGE_SIZE] = {
+    NO_LIMIT,
+    { 0, 1 },                                       // Latency_Reset
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+    NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT, NO_LIMIT,
+};
+
+// writeMask theo Docs/modbus_map.md: thanh ghi R (Actual_Speed, Status_Word, đo lường...) không ghi được
+const HoldingRegisterPage_t g_holdingPages[HOLDING_PAGE_COUNT] = {
+    [0x000] = { holdingStorage[SLOT_MOTOR1],        0x8FF7, motorLimits },
+    [0x001] = { holdingStorage[SLOT_MOTOR2],        0x8FF7, motorLimits },
+    [0x002] = { holdingStorage[SLOT_DI],            0x001E, diLimits },
+    [0x003] = { holdingStorage[SLOT_DO],            0x001E, doLimits },
+    [0x004] = { holdingStorage[SLOT_ENCODER],       0x017C, encoderLimits },
+    [0x00D] = { holdingStorage[SLOT_FAST_POLL_MAP], 0xFFFF, NULL },
+    [0x00E] = { holdingStorage[SLOT_PID_DEBUG],     0x0000, NULL },
+    [0x00F] = { holdingStorage[SLOT_FAST_POLL],     0x0000, NULL },
+    [0x010] = { holdingStorage[SLOT_SYSTEM],        0x4E0F, systemLimits },
+    [0x011] = { holdingStorage[SLOT_COMM],          0x1C00, commLimits },
+    [0x012] = { holdingStorage[SLOT_TELEMETRY],     0x1A93, telemetryLimits },
+    [0x013] = { holdingStorage[SLOT_LATENCY],       0x0003, latencyLimits },
+};
 
 // Global register arrays definition
-uint16_t g_holdingRegisters[HOLDING_REG_COUNT];
 uint16_t g_inputRegisters[INPUT_REG_COUNT];
 uint8_t g_coils[COIL_COUNT];
 uint8_t g_discreteInputs[DISCRETE_COUNT];
@@ -35,6 +219,18 @@ uint32_t g_timeoutCount = 0;
 uint32_t g_queueFullCount = 0;
 uint32_t g_lastResetTime = 0;
 uint8_t g_receivedIndex = 0;
+uint32_t g_overrunCount = 0;
+uint32_t g_uartErrorCount = 0;
+uint16_t g_lastFrameBytes = 0;
+uint16_t g_maxFrameBytes = 0;
+uint32_t g_t15ViolationCount = 0;
+uint32_t g_broadcastCount = 0;
+uint32_t g_exceptionCount = 0;
+uint32_t g_slaveMessageCount = 0;
+uint32_t g_snapshotCycle = 0;
+uint32_t g_autoBaudRate = 0;
+uint16_t g_t15Us = 0;
+uint16_t g_t35Us = 0;
 
 // LED indicator flag
 uint8_t g_ledIndicator = 0;
@@ -43,84 +239,129 @@ uint8_t g_ledIndicator = 0;
 uint32_t last_health_check = 0;
 static uint8_t uart_error_count = 0;
 
+// Nội dung mặc định của fast poll block: toàn bộ trạng thái drive trong 1 lần FC3
+static const uint16_t defaultFastPollMap[FAST_POLL_COUNT] = {
+    REG_SNAPSHOT_CYCLE_LO,
+    REG_SYSTEM_STATUS,
+    REG_SYSTEM_ERROR,
+    REG_M1_STATUS_WORD,
+    REG_M1_ACTUAL_SPEED,
+    REG_M1_POSITION_CURRENT,
+    REG_M1_ERROR_CODE,
+    REG_M2_STATUS_WORD,
+    REG_M2_ACTUAL_SPEED,
+    REG_M2_POSITION_CURRENT,
+    REG_M2_ERROR_CODE,
+    REG_ENCODER_COUNT,
+    REG_ENCODER_UNROLLED_WIRE_LENGTH_CM,
+    REG_ENCODER_CALIB_STATUS,
+    REG_DI_STATUS_WORD,
+    REG_DO_STATUS_WORD,
+};
+
 void initializeModbusRegisters(void) {
     // Initialize all registers to default values
     
     // System Registers (0x00F0-0x00F6)
-    g_holdingRegisters[REG_DEVICE_ID] = DEFAULT_DEVICE_ID;  
-    g_holdingRegisters[REG_CONFIG_BAUDRATE] = DEFAULT_CONFIG_BAUDRATE;
-    g_holdingRegisters[REG_CONFIG_PARITY] = DEFAULT_CONFIG_PARITY;
-    g_holdingRegisters[REG_CONFIG_STOP_BIT] = DEFAULT_CONFIG_STOP_BIT;
-    g_holdingRegisters[REG_MODULE_TYPE] = DEFAULT_MODULE_TYPE;
-    g_holdingRegisters[REG_FIRMWARE_VERSION] = DEFAULT_FIRMWARE_VERSION;
-    g_holdingRegisters[REG_HARDWARE_VERSION] = DEFAULT_HARDWARE_VERSION;
-    g_holdingRegisters[REG_SYSTEM_STATUS] = DEFAULT_SYSTEM_STATUS;
-    g_holdingRegisters[REG_SYSTEM_ERROR] = DEFAULT_SYSTEM_ERROR;
-    g_holdingRegisters[REG_RESET_ERROR_COMMAND] = DEFAULT_RESET_ERROR_COMMAND;
+    HREG(REG_DEVICE_ID) = DEFAULT_DEVICE_ID;  
+    HREG(REG_CONFIG_BAUDRATE) = DEFAULT_CONFIG_BAUDRATE;
+    HREG(REG_CONFIG_PARITY) = DEFAULT_CONFIG_PARITY;
+    HREG(REG_CONFIG_STOP_BIT) = DEFAULT_CONFIG_STOP_BIT;
+    HREG(REG_MODULE_TYPE) = DEFAULT_MODULE_TYPE;
+    HREG(REG_FIRMWARE_VERSION) = DEFAULT_FIRMWARE_VERSION;
+    HREG(REG_HARDWARE_VERSION) = DEFAULT_HARDWARE_VERSION;
+    HREG(REG_SYSTEM_STATUS) = DEFAULT_SYSTEM_STATUS;
+    HREG(REG_SYSTEM_ERROR) = DEFAULT_SYSTEM_ERROR;
+    HREG(REG_RESET_ERROR_COMMAND) = DEFAULT_RESET_ERROR_COMMAND;
+    HREG(REG_CONFIG_REVERT_TIMEOUT) = 0;
+    HREG(REG_CONFIG_STATUS) = SERIAL_CONFIG_APPLIED;
+
+    // RS-485 (0x011A-0x011C)
+    HREG(REG_RS485_PRE_GUARD_US) = 0;
+    HREG(REG_RS485_POST_GUARD_US) = 0;
+    HREG(REG_RS485_DE_MODE) = RS485_DE_ACTIVE_HIGH;
+
+    // Telemetry (0x0120-0x0123)
+    HREG(REG_TELEMETRY_MOTOR) = 0;
+    HREG(REG_TELEMETRY_DECIMATION) = 1;
+
+    // Control loop (0x0124-0x0127)
+    HREG(REG_CONTROL_RATE_HZ) = DEFAULT_CONTROL_RATE_HZ;
+
+    // Speed feedback (0x012A-0x012B)
+    HREG(REG_SPEED_RATED_RPM) = DEFAULT_RATED_SPEED_RPM;
+
+    // Motion profile (0x012C)
+    HREG(REG_PROFILE_JERK_MS) = DEFAULT_PROFILE_JERK_MS;
     
     // Motor 1 Registers (0x0000-0x000C)
-    g_holdingRegisters[REG_M1_CONTROL_MODE] = DEFAULT_CONTROL_MODE;
-    g_holdingRegisters[REG_M1_ENABLE] = DEFAULT_ENABLE;
-    g_holdingRegisters[REG_M1_COMMAND_SPEED] = DEFAULT_COMMAND_SPEED;
-    g_holdingRegisters[REG_M1_ACTUAL_SPEED] = DEFAULT_ACTUAL_SPEED;
-    g_holdingRegisters[REG_M1_DIRECTION] = DEFAULT_DIRECTION;
-    g_holdingRegisters[REG_M1_PID_KP] = DEFAULT_PID_KP;
-    g_holdingRegisters[REG_M1_PID_KI] = DEFAULT_PID_KI;
-    g_holdingRegisters[REG_M1_PID_KD] = DEFAULT_PID_KD;
-    g_holdingRegisters[REG_M1_STATUS_WORD] = DEFAULT_STATUS_WORD;
-    g_holdingRegisters[REG_M1_ERROR_CODE] = DEFAULT_ERROR_CODE;
-    g_holdingRegisters[REG_M1_MAX_SPEED] = DEFAULT_MAX_SPEED;
-    g_holdingRegisters[REG_M1_MIN_SPEED] = DEFAULT_MIN_SPEED;
-    g_holdingRegisters[REG_M1_MAX_ACCELERATION] = DEFAULT_MAX_ACCELERATION;
-    g_holdingRegisters[REG_M1_MAX_DECELERATION] = DEFAULT_MAX_DECELERATION;
-    g_holdingRegisters[REG_M1_POSITION_CURRENT] = 0;
-    g_holdingRegisters[REG_M1_POSITION_TARGET] = 0;
+    HREG(REG_M1_CONTROL_MODE) = DEFAULT_CONTROL_MODE;
+    HREG(REG_M1_ENABLE) = DEFAULT_ENABLE;
+    HREG(REG_M1_COMMAND_SPEED) = DEFAULT_COMMAND_SPEED;
+    HREG(REG_M1_ACTUAL_SPEED) = DEFAULT_ACTUAL_SPEED;
+    HREG(REG_M1_DIRECTION) = DEFAULT_DIRECTION;
+    HREG(REG_M1_PID_KP) = DEFAULT_PID_KP;
+    HREG(REG_M1_PID_KI) = DEFAULT_PID_KI;
+    HREG(REG_M1_PID_KD) = DEFAULT_PID_KD;
+    HREG(REG_M1_STATUS_WORD) = DEFAULT_STATUS_WORD;
+    HREG(REG_M1_ERROR_CODE) = DEFAULT_ERROR_CODE;
+    HREG(REG_M1_MAX_SPEED) = DEFAULT_MAX_SPEED;
+    HREG(REG_M1_MIN_SPEED) = DEFAULT_MIN_SPEED;
+    HREG(REG_M1_MAX_ACCELERATION) = DEFAULT_MAX_ACCELERATION;
+    HREG(REG_M1_MAX_DECELERATION) = DEFAULT_MAX_DECELERATION;
+    HREG(REG_M1_POSITION_CURRENT) = 0;
+    HREG(REG_M1_POSITION_TARGET) = 0;
     
     // Motor 2 Registers (0x0010-0x001C)
-    g_holdingRegisters[REG_M2_CONTROL_MODE] = DEFAULT_CONTROL_MODE;
-    g_holdingRegisters[REG_M2_ENABLE] = DEFAULT_ENABLE;
-    g_holdingRegisters[REG_M2_COMMAND_SPEED] = DEFAULT_COMMAND_SPEED;
-    g_holdingRegisters[REG_M2_ACTUAL_SPEED] = DEFAULT_ACTUAL_SPEED;
-    g_holdingRegisters[REG_M2_DIRECTION] = DEFAULT_DIRECTION;
-    g_holdingRegisters[REG_M2_PID_KP] = DEFAULT_PID_KP;
-    g_holdingRegisters[REG_M2_PID_KI] = DEFAULT_PID_KI;
-    g_holdingRegisters[REG_M2_PID_KD] = DEFAULT_PID_KD;
-    g_holdingRegisters[REG_M2_STATUS_WORD] = DEFAULT_STATUS_WORD;
-    g_holdingRegisters[REG_M2_ERROR_CODE] = DEFAULT_ERROR_CODE;
-    g_holdingRegisters[REG_M2_MAX_SPEED] = DEFAULT_MAX_SPEED;
-    g_holdingRegisters[REG_M2_MIN_SPEED] = DEFAULT_MIN_SPEED;
-    g_holdingRegisters[REG_M2_MAX_ACCELERATION] = DEFAULT_MAX_ACCELERATION;
-    g_holdingRegisters[REG_M2_MAX_DECELERATION] = DEFAULT_MAX_DECELERATION;
-    g_holdingRegisters[REG_M2_POSITION_CURRENT] = 0;
-    g_holdingRegisters[REG_M2_POSITION_TARGET] = 0;
+    HREG(REG_M2_CONTROL_MODE) = DEFAULT_CONTROL_MODE;
+    HREG(REG_M2_ENABLE) = DEFAULT_ENABLE;
+    HREG(REG_M2_COMMAND_SPEED) = DEFAULT_COMMAND_SPEED;
+    HREG(REG_M2_ACTUAL_SPEED) = DEFAULT_ACTUAL_SPEED;
+    HREG(REG_M2_DIRECTION) = DEFAULT_DIRECTION;
+    HREG(REG_M2_PID_KP) = DEFAULT_PID_KP;
+    HREG(REG_M2_PID_KI) = DEFAULT_PID_KI;
+    HREG(REG_M2_PID_KD) = DEFAULT_PID_KD;
+    HREG(REG_M2_STATUS_WORD) = DEFAULT_STATUS_WORD;
+    HREG(REG_M2_ERROR_CODE) = DEFAULT_ERROR_CODE;
+    HREG(REG_M2_MAX_SPEED) = DEFAULT_MAX_SPEED;
+    HREG(REG_M2_MIN_SPEED) = DEFAULT_MIN_SPEED;
+    HREG(REG_M2_MAX_ACCELERATION) = DEFAULT_MAX_ACCELERATION;
+    HREG(REG_M2_MAX_DECELERATION) = DEFAULT_MAX_DECELERATION;
+    HREG(REG_M2_POSITION_CURRENT) = 0;
+    HREG(REG_M2_POSITION_TARGET) = 0;
 
     // Input Registers (0x0020-0x0024)
-    g_holdingRegisters[REG_DI_STATUS_WORD] = 0;
-    g_holdingRegisters[REG_DI1_ASSIGNMENT] = 0;
-    g_holdingRegisters[REG_DI2_ASSIGNMENT] = 0;
-    g_holdingRegisters[REG_DI3_ASSIGNMENT] = 0;
-    g_holdingRegisters[REG_DI4_ASSIGNMENT] = 0;
-    g_holdingRegisters[REG_CURRENT] = DEFAULT_CURRENT;
+    HREG(REG_DI_STATUS_WORD) = 0;
+    HREG(REG_DI1_ASSIGNMENT) = 0;
+    HREG(REG_DI2_ASSIGNMENT) = 0;
+    HREG(REG_DI3_ASSIGNMENT) = 0;
+    HREG(REG_DI4_ASSIGNMENT) = 0;
+    HREG(REG_CURRENT) = DEFAULT_CURRENT;
     // Output Registers (0x0040-0x0044)  
-    g_holdingRegisters[REG_DO_STATUS_WORD] = 0;
-    g_holdingRegisters[REG_DO1_CONTROL] = 0;
-    g_holdingRegisters[REG_DO1_ASSIGNMENT] = 0;
-    g_holdingRegisters[REG_DO2_CONTROL] = 0;
-    g_holdingRegisters[REG_DO2_ASSIGNMENT] = 0;
+    HREG(REG_DO_STATUS_WORD) = 0;
+    HREG(REG_DO1_CONTROL) = 0;
+    HREG(REG_DO1_ASSIGNMENT) = 0;
+    HREG(REG_DO2_CONTROL) = 0;
+    HREG(REG_DO2_ASSIGNMENT) = 0;
 
     // Encoder Registers (0x0040-0x004D)
-    g_holdingRegisters[REG_ENCODER_STATUS_WORD] = 0;
-    g_holdingRegisters[REG_ENCODER_COUNT] = 0;
-    g_holdingRegisters[REG_ENCODER_REVOLUTIONS] = 8;
-    g_holdingRegisters[REG_ENCODER_RMAX] = 35;
-    g_holdingRegisters[REG_ENCODER_RMIN] = 20;
-    g_holdingRegisters[REG_ENCODER_WIRE_LENGTH_CM] = 300;
-    g_holdingRegisters[REG_ENCODER_RESET] = 0;
-    g_holdingRegisters[REG_ENCODER_CALIB_WIRE_LENGTH_CM] = 300;
-    g_holdingRegisters[REG_ENCODER_CALIB_STATUS] = 0;
-    g_holdingRegisters[REG_ENCODER_CALIB_CURRENT_LENGTH_CM] = 0;
-    g_holdingRegisters[REG_ENCODER_CALIB_ORIGIN_STATUS] = 0;
-    g_holdingRegisters[REG_ENCODER_UNROLLED_WIRE_LENGTH_CM] = 0;
+    HREG(REG_ENCODER_STATUS_WORD) = 0;
+    HREG(REG_ENCODER_COUNT) = 0;
+    HREG(REG_ENCODER_REVOLUTIONS) = 8;
+    HREG(REG_ENCODER_RMAX) = 35;
+    HREG(REG_ENCODER_RMIN) = 20;
+    HREG(REG_ENCODER_WIRE_LENGTH_CM) = 300;
+    HREG(REG_ENCODER_RESET) = 0;
+    HREG(REG_ENCODER_CALIB_WIRE_LENGTH_CM) = 300;
+    HREG(REG_ENCODER_CALIB_STATUS) = 0;
+    HREG(REG_ENCODER_CALIB_CURRENT_LENGTH_CM) = 0;
+    HREG(REG_ENCODER_CALIB_ORIGIN_STATUS) = 0;
+    HREG(REG_ENCODER_UNROLLED_WIRE_LENGTH_CM) = 0;
+
+    // Fast Poll Map (0x00D0-0x00DF)
+    for (int i = 0; i < FAST_POLL_COUNT; i++) {
+        HREG(REG_FAST_POLL_MAP_START + i) = defaultFastPollMap[i];
+    }
 
     // Initialize other arrays
     for (int i = 0; i < INPUT_REG_COUNT; i++) {
@@ -134,126 +375,870 @@ void initializeModbusRegisters(void) {
     for (int i = 0; i < DISCRETE_COUNT; i++) {
         g_discreteInputs[i] = 0;
     }
+
+    // Mọi task phải load lại toàn bộ giá trị mặc định
+    markRegistersDirty(0, HOLDING_REG_COUNT);
+    publishProcessImage();
+}
+
+// ═══════════════════════════════════════════════════════════════
+// RS-485 DRIVER ENABLE (PA1)
+// ═══════════════════════════════════════════════════════════════
+// Bật DE ngay trước khi DMA TX chạy và nhả trong ngắt TC (byte cuối đã ra dây),
+// nên bus quay về chiều nhận sau ~1 bit thay vì phụ thuộc mạch tự đảo chiều.
+// Post guard không chờ trong ngắt TC: TIM4 (đang rảnh vì bus thuộc về drive) chạy
+// one-pulse Post_Guard_us rồi nhả DE trong ngắt UPDATE.
+
+static void setDriverEnable(uint8_t transmit) {
+    uint16_t mode = HREG(REG_RS485_DE_MODE);
+    GPIO_PinState level = GPIO_PIN_RESET;
+
+    if (mode == RS485_DE_ACTIVE_HIGH) {
+        level = transmit ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    } else if (mode == RS485_DE_ACTIVE_LOW) {
+        level = transmit ? GPIO_PIN_RESET : GPIO_PIN_SET;
+    }
+    HAL_GPIO_WritePin(RS485_DE_GPIO_Port, RS485_DE_Pin, level);
+}
+
+// Chờ bận theo DWT (đã bật ở ModbusLatency_Init)
+static void delayUs(uint16_t us) {
+    uint32_t start = DWT->CYCCNT;
+    uint32_t cycles = us * (SystemCoreClock / 1000000U);
+    while (DWT->CYCCNT - start < cycles) {
+    }
+}
+
+static uint16_t getDMAWritePos(void) {
+    uint16_t writePos = RX_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(huart2.hdmarx);
+    if (writePos >= RX_DMA_BUFFER_SIZE) {
+        writePos = 0;
+    }
+    return writePos;
 }
 
-uint16_t calcCRC(uint8_t *buf, int len) {
-    uint16_t crc = 0xFFFF;
-    for (int pos = 0; pos < len; pos++) {
-        crc ^= (uint16_t)buf[pos];
-        for (int i = 8; i != 0; i--) {
-            if ((crc & 0x0001) != 0) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            } else {
-                crc >>= 1;
+static void stopFrameTimer(void) {
+    __HAL_TIM_DISABLE(&htim4);
+    __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE | TIM_FLAG_CC1);
+}
+
+// TIM4 one-pulse đếm post guard (1 tick = 1 µs), ARR của T3.5 nạp lại khi xong
+static void startPostGuard(uint16_t us) {
+    txPostGuardActive = 1;
+    stopFrameTimer();
+    __HAL_TIM_SET_COUNTER(&htim4, 0);
+    __HAL_TIM_SET_AUTORELOAD(&htim4, us - 1);
+    __HAL_TIM_ENABLE(&htim4);
+}
+
+static void stopPostGuard(void) {
+    stopFrameTimer();
+    __HAL_TIM_SET_AUTORELOAD(&htim4, frameTimerReload);
+    txPostGuardActive = 0;
+}
+
+// Response đã ra hết và DE đã nhả - giải phóng txBuffer, báo UartTask
+static void finishTransmit(void) {
+    setDriverEnable(0);
+    txBusy = 0;
+    ModbusLatency_MarkTxDone();
+    if (modbusTaskHandle != NULL) {
+        osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_TX_DONE);
+    }
+}
+
+static void startDMAReception(void) {
+    stopFrameTimer();
+    rxDmaReadPos = 0;
+    HAL_UART_Receive_DMA(&huart2, rxDmaBuffer, RX_DMA_BUFFER_SIZE);
+
+    // Buffer vòng không cần ngắt HT/TC của DMA - chỉ dùng ngắt IDLE (1 ngắt / frame)
+    __HAL_DMA_DISABLE_IT(huart2.hdmarx, DMA_IT_HT | DMA_IT_TC);
+    __HAL_UART_CLEAR_IDLEFLAG(&huart2);
+    __HAL_UART_ENABLE_IT(&huart2, UART_IT_IDLE);
+}
+
+// Tính T1.5/T3.5 theo baudrate (1 ký tự RTU = 11 bit) và nạp vào TIM4 (1 tick = 1 µs).
+// TIM4 được khởi động tại ngắt IDLE, tức là khi đường truyền đã im lặng 1 ký tự,
+// nên CC1 = T1.5 - 1 ký tự và ARR (update, one-pulse) = T3.5 - 1 ký tự.
+static void updateFrameTimers(uint32_t baudrate) {
+    uint32_t charUs = (11UL * 1000000UL + baudrate - 1) / baudrate;
+
+    g_t15Us = (uint16_t)((charUs * 3 + 1) / 2);
+    g_t35Us = (uint16_t)((charUs * 7 + 1) / 2);
+
+    frameTimerReload = (uint16_t)(g_t35Us - charUs);
+    stopFrameTimer();
+    __HAL_TIM_SET_COMPARE(&htim4, TIM_CHANNEL_1, g_t15Us - charUs);
+    __HAL_TIM_SET_AUTORELOAD(&htim4, frameTimerReload);
+}
+
+// Copy frame [rxDmaReadPos, writePos) ra rxBuffer và báo cho UartTask
+static void dispatchFrame(uint16_t writePos) {
+    uint16_t length = (writePos + RX_DMA_BUFFER_SIZE - rxDmaReadPos) % RX_DMA_BUFFER_SIZE;
+
+    g_totalReceived++;
+    g_lastFrameBytes = length;
+    if (length > g_maxFrameBytes) {
+        g_maxFrameBytes = length;
+    }
+
+    if (frameReceived || length > RX_BUFFER_SIZE) {
+        // Frame trước chưa xử lý xong hoặc frame quá dài - bỏ frame này
+        g_overrunCount++;
+    } else {
+        // Copy frame ra buffer tuyến tính (xử lý trường hợp vòng qua cuối buffer)
+        // và tính CRC luôn trong cùng vòng lặp: O(n) trong ISR, nhưng chỉ 1 lần
+        // tra bảng / byte thêm vào lần copy vốn phải làm, UartTask chỉ so residue
+        uint16_t pos = rxDmaReadPos;
+        uint16_t crc = MODBUS_CRC_INIT;
+        for (uint16_t i = 0; i < length; i++) {
+            uint8_t byte = rxDmaBuffer[pos];
+            rxBuffer[i] = byte;
+            crc = modbusCRCUpdate(crc, byte);
+            if (++pos >= RX_DMA_BUFFER_SIZE) {
+                pos = 0;
             }
         }
+        rxFrameCRC = crc;
+        rxIndex = length;
+        frameReceived = 1;
+        ModbusLatency_MarkRxEnd();
+        // Đánh dấu để LED nháy
+        g_ledIndicator = 1;
+
+        if (modbusTaskHandle != NULL) {
+            osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_FRAME_READY);
+        }
+    }
+
+    rxDmaReadPos = writePos;
+}
+
+void handleUARTIdleInterrupt(void) {
+    if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_IDLE) == RESET ||
+        __HAL_UART_GET_IT_SOURCE(&huart2, UART_IT_IDLE) == RESET) {
+        return;
+    }
+    __HAL_UART_CLEAR_IDLEFLAG(&huart2);
+
+    uint16_t writePos = getDMAWritePos();
+    if (writePos == rxDmaReadPos) {
+        return;
+    }
+
+    g_lastUARTActivity = HAL_GetTick();
+
+    // Master đã gửi tiếp trong lúc đếm post guard - nhả bus ngay, TIM4 quay về đo frame
+    if (txPostGuardActive) {
+        stopPostGuard();
+        finishTransmit();
+    }
+
+    // Đường truyền đã im lặng 1 ký tự - đo tiếp đến T1.5 / T3.5 bằng TIM4
+    rxIdleWritePos = writePos;
+    __HAL_TIM_DISABLE(&htim4);
+    __HAL_TIM_SET_COUNTER(&htim4, 0);
+    __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE | TIM_FLAG_CC1);
+    __HAL_TIM_ENABLE(&htim4);
+}
+
+void handleModbusTimerInterrupt(void) {
+    if (txPostGuardActive) {
+        // CC1 (mốc T1.5) vẫn có thể khớp trong lúc đếm post guard - bỏ qua
+        __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_CC1);
+        if (__HAL_TIM_GET_FLAG(&htim4, TIM_FLAG_UPDATE) != RESET) {
+            stopPostGuard();
+            finishTransmit();
+        }
+        return;
+    }
+
+    if (__HAL_TIM_GET_FLAG(&htim4, TIM_FLAG_CC1) != RESET) {
+        __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_CC1);
+
+        // T1.5: có byte mới trước mốc này => khoảng lặng hợp lệ giữa 2 ký tự
+        // trong cùng frame, dừng đo và chờ IDLE tiếp theo
+        if (getDMAWritePos() != rxIdleWritePos) {
+            stopFrameTimer();
+            return;
+        }
+    }
+
+    if (__HAL_TIM_GET_FLAG(&htim4, TIM_FLAG_UPDATE) != RESET) {
+        __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE);
+
+        // T3.5: timer one-pulse đã tự dừng
+        if (getDMAWritePos() == rxIdleWritePos) {
+            // Im lặng đủ T3.5 - kết thúc frame
+            dispatchFrame(rxIdleWritePos);
+        } else {
+            // Byte mới đến giữa T1.5 và T3.5 - frame không hợp lệ theo spec RTU,
+            // bỏ phần đã nhận, các byte mới thuộc frame sau
+            g_t15ViolationCount++;
+            rxDmaReadPos = rxIdleWritePos;
+        }
     }
-    return crc;
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
     if (huart->Instance == USART2) {
-        g_lastUARTActivity = HAL_GetTick();
-        
-        if (rxIndex < RX_BUFFER_SIZE - 1) {
-            // Lưu byte vừa nhận
-            rxBuffer[rxIndex++] = rxByte;
-            
-            // Kiểm tra xem có đủ frame chưa
-            if (rxIndex >= 3) {
-                uint8_t funcCode = rxBuffer[1];
-                uint8_t expectedLength = 0;
-                
-                switch(funcCode) {
-                    case 3:  // Read holding registers
-                    case 4:  // Read input registers
-                    case 6:  // Write single register
-                        expectedLength = 8;
-                        break;
-                    case 16: // Write multiple registers
-                        if (rxIndex >= 7) {
-                            expectedLength = 9 + rxBuffer[6];
-                        }
-                        break;
-                    default:
-                        // Function code không hợp lệ - reset
-                        rxIndex = 0;
-                        frameReceived = 0;
-                        break;
-                }
-                
-                // Nếu đã nhận đủ frame theo expectedLength
-                if (expectedLength > 0 && rxIndex >= expectedLength) {
-                    frameReceived = 1;
-                    // Đánh dấu để LED nháy
-                    g_ledIndicator = 1;
-                }
-            }
+        // Gọi khi byte cuối đã ra khỏi shift register (cờ TC)
+        if (HREG(REG_RS485_POST_GUARD_US) != 0) {
+            startPostGuard(HREG(REG_RS485_POST_GUARD_US));
         } else {
-            // Buffer overflow - reset
-            rxIndex = 0;
-            frameReceived = 0;
+            finishTransmit();
         }
-        
-        // Tiếp tục nhận byte tiếp theo
-        HAL_UART_Receive_IT(&huart2, &rxByte, 1);
     }
 }
 
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
     if (huart->Instance == USART2) {
-        rxIndex = 0;
-        frameReceived = 0;
-        HAL_UART_Abort(&huart2);
-        HAL_UART_Receive_IT(&huart2, &rxByte, 1);
+        g_uartErrorCount++;
+        // Lỗi DMA TX làm HAL kết thúc truyền - giải phóng txBuffer
+        if (txBusy && huart->gState == HAL_UART_STATE_READY) {
+            txBusy = 0;
+        }
+        // Auto-baud: master đổi tốc độ thì chỉ còn thấy framing error - đo lại
+        if (current_baudrate == BAUDRATE_CODE_AUTO && (huart->ErrorCode & HAL_UART_ERROR_FE) &&
+            ++autoBaudFramingErrors >= AUTOBAUD_RELOCK_ERRORS) {
+            autoBaudFramingErrors = 0;
+            autoBaudRelock = 1;
+            if (modbusTaskHandle != NULL) {
+                osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_AUTOBAUD);
+            }
+        }
+        // Lỗi khi DMA đang chạy làm HAL dừng RX - khởi động lại (trừ khi đang đo baud)
+        if (huart->RxState == HAL_UART_STATE_READY && !autoBaudActive) {
+            startDMAReception();
+        }
     }
 }
 
 void resetUARTCommunication(void) {
     HAL_UART_Abort(&huart2);
+    if (txPostGuardActive) {
+        stopPostGuard();
+    }
+    setDriverEnable(0);
+    txBusy = 0;
     rxIndex = 0;
     frameReceived = 0;
-    HAL_UART_Receive_IT(&huart2, &rxByte, 1);
+    if (!autoBaudActive) {
+        startDMAReception();
+    }
+}
+
+// Con trỏ tới thanh ghi, NULL nếu địa chỉ không nằm trong page đã map
+static uint16_t *holdingRegisterPtr(uint16_t addr) {
+    if (addr >= HOLDING_REG_COUNT || g_holdingPages[addr >> HOLDING_PAGE_SHIFT].storage == NULL) {
+        return NULL;
+    }
+    return &HREG(addr);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DIRTY BITMAP
+// ═══════════════════════════════════════════════════════════════
+// UartTask đánh dấu thanh ghi khi master ghi; Motor/Encoder task chỉ
+// load lại block có bit dirty và không Save đè lên giá trị master vừa ghi.
+// Test-and-clear chạy với PRIMASK để UartTask không chen vào giữa.
+
+void markRegistersDirty(uint16_t start, uint16_t count) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint16_t addr = start; addr < start + count && addr < HOLDING_REG_COUNT; addr++) {
+        dirtyBitmap[addr >> 5] |= 1UL << (addr & 31);
+        if (addr < PROCESS_IMAGE_COUNT) {
+            writtenSinceSnapshot[addr >> 5] |= 1UL << (addr & 31);
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+// Trả về 1 nếu có thanh ghi nào trong block bị ghi từ lần gọi trước (và xóa các bit đó)
+uint8_t consumeDirtyRegisters(uint16_t start, uint16_t count) {
+    uint32_t dirty = 0;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint16_t addr = start; addr < start + count && addr < HOLDING_REG_COUNT; addr++) {
+        uint32_t bit = 1UL << (addr & 31);
+        dirty |= dirtyBitmap[addr >> 5] & bit;
+        dirtyBitmap[addr >> 5] &= ~bit;
+    }
+    __set_PRIMASK(primask);
+    return dirty != 0;
+}
+
+// Firmware ghi trạng thái ra thanh ghi - bỏ qua nếu master vừa ghi mà chưa được load
+void saveHoldingRegister(uint16_t addr, uint16_t value) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if ((dirtyBitmap[addr >> 5] & (1UL << (addr & 31))) == 0) {
+        HREG(addr) = value;
+    }
+    __set_PRIMASK(primask);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PROCESS IMAGE (double buffer)
+// ═══════════════════════════════════════════════════════════════
+// Gọi ở cuối chu kỳ MotorTask, sau khi mọi Save đã xong.
+// Buffer active chỉ bị ghi đè sau 2 lần publish. MotorTask (Realtime, nhịp TIM3)
+// có thể chen vào giữa lúc UartTask đọc - streamHoldingRegisters đọc lại nếu
+// processImageSeq đã tăng từ 2 trở lên.
+
+void publishProcessImage(void) {
+    uint32_t next = processImageSeq + 1;
+    ProcessImage_t *img = &processImage[next & 1];
+
+    g_snapshotCycle++;
+    HREG(REG_SNAPSHOT_CYCLE_LO) = g_snapshotCycle & 0xFFFF;
+    HREG(REG_SNAPSHOT_CYCLE_HI) = g_snapshotCycle >> 16;
+
+    // Xóa trước khi copy: lệnh ghi chen vào sau đó vẫn được đọc từ live image
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(writtenSinceSnapshot, 0, sizeof(writtenSinceSnapshot));
+    __set_PRIMASK(primask);
+
+    img->cycle = g_snapshotCycle;
+    memcpy(img->regs, holdingStorage[SLOT_MOTOR1], sizeof(img->regs));
+    for (int i = 0; i < FAST_POLL_COUNT; i++) {
+        const uint16_t *src = holdingRegisterPtr(HREG(REG_FAST_POLL_MAP_START + i));
+        img->fastPoll[i] = (src != NULL) ? *src : 0;
+        HREG(REG_FAST_POLL_START + i) = img->fastPoll[i];
+    }
+    __DMB();
+    processImageSeq = next;
+}
+
+// Đọc 1 holding register cho FC3/FC23: process image, trừ khi master vừa ghi
+static uint16_t readHoldingRegister(const ProcessImage_t *img, uint16_t addr) {
+    if (addr >= REG_FAST_POLL_START && addr < REG_FAST_POLL_START + FAST_POLL_COUNT) {
+        return img->fastPoll[addr - REG_FAST_POLL_START];
+    }
+    if (addr < PROCESS_IMAGE_COUNT &&
+        (writtenSinceSnapshot[addr >> 5] & (1UL << (addr & 31))) == 0) {
+        return img->regs[addr];
+    }
+    return HREG(addr);
+}
+
+// Ghi qty register big-endian vào txBuffer từ txIndex, cập nhật CRC ngay trong cùng
+// vòng lặp - không phải đọc lại payload lần 2 để tính CRC
+static uint16_t streamHoldingRegisters(uint16_t txIndex, uint16_t addr, uint16_t qty, uint16_t *crc) {
+    uint32_t seq;
+    uint16_t c;
+
+    do {
+        seq = processImageSeq;
+        const ProcessImage_t *img = &processImage[seq & 1];
+        uint8_t *dest = &txBuffer[txIndex];
+        c = *crc;
+
+        for (uint16_t i = 0; i < qty; i++) {
+            uint16_t value = readHoldingRegister(img, addr + i);
+            uint8_t hi = value >> 8;
+            uint8_t lo = value & 0xFF;
+            dest[0] = hi;
+            dest[1] = lo;
+            dest += 2;
+            c = modbusCRCUpdate(modbusCRCUpdate(c, hi), lo);
+        }
+        // Đã publish 2 lần trong lúc đọc -> buffer vừa đọc có thể bị ghi dở
+    } while (processImageSeq - seq >= 2);
+    *crc = c;
+    return txIndex + qty * 2;
+}
+
+// Exception code cho FC3/FC23 đọc [addr, addr + qty): 0 = OK, 0x02 = có page không map.
+// Ô trống trong page đã map (vd. 0x0047) đọc ra 0 để master vẫn đọc được cả block.
+static uint8_t checkHoldingRead(uint16_t addr, uint16_t qty) {
+    if ((uint32_t)addr + qty > HOLDING_REG_COUNT) {
+        return 0x02;
+    }
+    for (uint16_t page = addr >> HOLDING_PAGE_SHIFT; page <= (addr + qty - 1) >> HOLDING_PAGE_SHIFT; page++) {
+        if (g_holdingPages[page].storage == NULL) {
+            return 0x02;
+        }
+    }
+    return 0;
+}
+
+// Kiểm tra cả lệnh ghi trước khi ghi thanh ghi nào (data = giá trị big-endian trong frame):
+// 0x02 = không map hoặc chỉ đọc, 0x03 = giá trị ngoài giới hạn
+static uint8_t checkHoldingWrite(uint16_t addr, uint16_t qty, const uint8_t *data) {
+    if ((uint32_t)addr + qty > HOLDING_REG_COUNT) {
+        return 0x02;
+    }
+    for (uint16_t i = 0; i < qty; i++) {
+        const HoldingRegisterPage_t *page = &g_holdingPages[(addr + i) >> HOLDING_PAGE_SHIFT];
+        if (page->storage == NULL || (page->writeMask & (1U << ((addr + i) & HOLDING_PAGE_MASK))) == 0) {
+            return 0x02;
+        }
+    }
+    for (uint16_t i = 0; i < qty; i++) {
+        const HoldingRegisterPage_t *page = &g_holdingPages[(addr + i) >> HOLDING_PAGE_SHIFT];
+        uint16_t value = (data[i * 2] << 8) | data[i * 2 + 1];
+        if (page->limits != NULL) {
+            const RegisterLimit_t *limit = &page->limits[(addr + i) & HOLDING_PAGE_MASK];
+            if (value < limit->min || value > limit->max) {
+                return 0x03;
+            }
+        }
+    }
+    return 0;
+}
+
+// Chốt đồng loạt các giá trị motor đã stage (trigger)
+static void applySyncStaged(void) {
+    for (uint16_t i = 0; i < SYNC_STAGED_COUNT; i++) {
+        if (syncStagedMask & (1UL << i)) {
+            HREG(SYNC_STAGED_START + i) = syncStaged[i];
+            markRegistersDirty(SYNC_STAGED_START + i, 1);
+        }
+    }
+    syncStagedMask = 0;
+    HREG(REG_SYNC_ARM) = 0;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// WRITE HANDLERS - tác dụng phụ khi master ghi vào 1 dải thanh ghi
+// ═══════════════════════════════════════════════════════════════
+typedef void (*RegisterWriteHandler_t)(uint16_t addr, uint16_t value);
+
+typedef struct {
+    uint16_t start;
+    uint16_t count;
+    RegisterWriteHandler_t handler;
+} RegisterWriteHook_t;
+
+static void onResetErrorWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    if (value == 1) {
+        HREG(REG_SYSTEM_ERROR) = 0;
+    }
+}
+
+static void onSyncArmWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    // Hủy ARM - bỏ các giá trị đã stage
+    if (value == 0) {
+        syncStagedMask = 0;
+    }
+}
+
+static void onSyncTriggerWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    if (value == 1) {
+        applySyncStaged();
+    }
+    HREG(REG_SYNC_TRIGGER) = 0;
+}
+
+static void onLatencyResetWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    if (value == 1) {
+        ModbusLatency_Reset();
+    }
+    HREG(REG_LATENCY_RESET) = 0;
+}
+
+static void onTelemetryMotorWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    (void)value;
+    // Đổi motor -> bỏ sample của motor cũ còn trong ring
+    Telemetry_Flush();
+}
+
+static void onControlOverrunWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    (void)value;
+    // Ghi 0: xóa Overrun_Count và Jitter_us
+    ControlLoop_ResetStats();
+}
+
+static void onDEModeWrite(uint16_t addr, uint16_t value) {
+    (void)addr;
+    (void)value;
+    // Không có response đang truyền (processModbusFrame đã chờ TX xong) - đặt mức nhận mới
+    setDriverEnable(0);
+}
+
+static void onDOControlWrite(uint16_t addr, uint16_t value) {
+    (void)value;
+    // Relay cập nhật ngay, không chờ chu kỳ IOTask (500 ms)
+    DOutput_Update((addr == REG_DO1_CONTROL) ? 1 : 2);
+}
+
+static const RegisterWriteHook_t writeHooks[] = {
+    { REG_RESET_ERROR_COMMAND, 1, onResetErrorWrite },
+    { REG_SYNC_ARM,            1, onSyncArmWrite },
+    { REG_SYNC_TRIGGER,        1, onSyncTriggerWrite },
+    { REG_DO1_CONTROL,         1, onDOControlWrite },
+    { REG_DO2_CONTROL,         1, onDOControlWrite },
+    { REG_LATENCY_RESET,       1, onLatencyResetWrite },
+    { REG_TELEMETRY_MOTOR,     1, onTelemetryMotorWrite },
+    { REG_RS485_DE_MODE,       1, onDEModeWrite },
+    { REG_CONTROL_OVERRUN_COUNT, 1, onControlOverrunWrite },
+};
+
+// Ghi 1 holding register từ master (FC5/6/15/16/23) kèm các tác dụng phụ của lệnh
+static void writeHoldingRegister(uint16_t addr, uint16_t value) {
+    // Đang ARM: giá trị cho block motor chỉ được stage, chờ trigger
+    // (block bắt đầu ở 0x0000 nên chỉ cần so cận trên)
+    if (HREG(REG_SYNC_ARM) != 0 && addr < SYNC_STAGED_START + SYNC_STAGED_COUNT) {
+        syncStaged[addr - SYNC_STAGED_START] = value;
+        syncStagedMask |= 1UL << (addr - SYNC_STAGED_START);
+        return;
+    }
+
+    HREG(addr) = value;
+    markRegistersDirty(addr, 1);
+
+    for (uint16_t i = 0; i < sizeof(writeHooks) / sizeof(writeHooks[0]); i++) {
+        if (addr >= writeHooks[i].start && addr < writeHooks[i].start + writeHooks[i].count) {
+            writeHooks[i].handler(addr, value);
+            break;
+        }
+    }
+}
+
+// Coil 0/1 = relay OUT1/OUT2, coil 2/3 = enable motor 1/2
+static void writeCoil(uint16_t addr, uint8_t value) {
+    switch (addr) {
+        case COIL_OUT1:
+            writeHoldingRegister(REG_DO1_CONTROL, value);
+            break;
+        case COIL_OUT2:
+            writeHoldingRegister(REG_DO2_CONTROL, value);
+            break;
+        case COIL_M1_ENABLE:
+            writeHoldingRegister(REG_M1_ENABLE, value);
+            break;
+        case COIL_M2_ENABLE:
+            writeHoldingRegister(REG_M2_ENABLE, value);
+            break;
+        default:
+            break;
+    }
+}
+
+// Đóng gói bit cho FC1/FC2: bit đầu tiên ở LSB của byte đầu tiên
+static uint16_t packBits(const uint8_t *bits, uint16_t addr, uint16_t qty, uint8_t *dest) {
+    uint16_t byteCount = (qty + 7) / 8;
+    memset(dest, 0, byteCount);
+    for (int i = 0; i < qty; i++) {
+        if (bits[addr + i]) {
+            dest[i >> 3] |= (uint8_t)(1U << (i & 7));
+        }
+    }
+    return byteCount;
+}
+
+// Chờ response trước truyền xong trước khi dùng lại txBuffer
+static void waitTransmitComplete(void) {
+    while (txBusy) {
+        if (osThreadGetId() == modbusTaskHandle) {
+            if (osThreadFlagsWait(MODBUS_FLAG_TX_DONE, osFlagsWaitAny, TX_TIMEOUT_MS) == (uint32_t)osFlagsErrorTimeout) {
+                // DMA TX bị treo - hủy để không khóa UART mãi
+                HAL_UART_AbortTransmit(&huart2);
+                if (txPostGuardActive) {
+                    stopPostGuard();
+                }
+                setDriverEnable(0);
+                txBusy = 0;
+                g_uartErrorCount++;
+            }
+        } else {
+            osDelay(1);
+        }
+    }
+}
+
+static void transmitResponse(uint16_t length) {
+    if (modbusTxMutex != NULL) {
+        osMutexAcquire(modbusTxMutex, osWaitForever);
+    }
+
+    txBusy = 1;
+    setDriverEnable(1);
+    if (HREG(REG_RS485_PRE_GUARD_US) != 0) {
+        delayUs(HREG(REG_RS485_PRE_GUARD_US));
+    }
+    ModbusLatency_MarkTxStart(txBuffer[1]);
+    if (HAL_UART_Transmit_DMA(&huart2, txBuffer, length) != HAL_OK) {
+        setDriverEnable(0);
+        txBusy = 0;
+        g_uartErrorCount++;
+    }
+
+    if (modbusTxMutex != NULL) {
+        osMutexRelease(modbusTxMutex);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// FC 0x08 DIAGNOSTICS / FC 0x2B DEVICE IDENTIFICATION
+// ═══════════════════════════════════════════════════════════════
+
+static void clearDiagnosticCounters(void) {
+    diagBaseline.busMessage = g_totalReceived;
+    diagBaseline.busCommError = g_corruptionCount;
+    diagBaseline.exception = g_exceptionCount;
+    diagBaseline.slaveMessage = g_slaveMessageCount;
+    diagBaseline.slaveNoResponse = g_broadcastCount;
+    diagBaseline.charOverrun = g_overrunCount;
+}
+
+// Trả về độ dài response trong txBuffer (đã có ID + FC ở byte 0-1)
+static uint16_t buildDiagnosticsResponse(void) {
+    uint16_t subFunction = (rxBuffer[2] << 8) | rxBuffer[3];
+    uint16_t data = (rxBuffer[4] << 8) | rxBuffer[5];
+    uint32_t count;
+
+    if (subFunction == 0x0000) {
+        // Return Query Data: echo nguyên PDU - dùng đo round-trip từ master
+        memcpy(&txBuffer[2], &rxBuffer[2], rxIndex - 4);
+        return rxIndex - 2;
+    }
+    if (rxIndex != 8 || (subFunction != 0x0001 && data != 0x0000) ||
+        (subFunction == 0x0001 && data != 0x0000 && data != 0xFF00)) {
+        txBuffer[1] |= 0x80;
+        txBuffer[2] = 0x03;
+        return 3;
+    }
+
+    switch (subFunction) {
+        case 0x0001:    // Restart Communications Option
+        case 0x000A:    // Clear Counters and Diagnostic Register
+            clearDiagnosticCounters();
+            count = data;
+            break;
+        case 0x000B:    // Bus Message Count
+            count = g_totalReceived - diagBaseline.busMessage;
+            break;
+        case 0x000C:    // Bus Communication Error Count (CRC)
+            count = g_corruptionCount - diagBaseline.busCommError;
+            break;
+        case 0x000D:    // Bus Exception Error Count
+            count = g_exceptionCount - diagBaseline.exception;
+            break;
+        case 0x000E:    // Slave Message Count
+            count = g_slaveMessageCount - diagBaseline.slaveMessage;
+            break;
+        case 0x000F:    // Slave No Response Count (broadcast)
+            count = g_broadcastCount - diagBaseline.slaveNoResponse;
+            break;
+        case 0x0012:    // Bus Character Overrun Count
+            count = g_overrunCount - diagBaseline.charOverrun;
+            break;
+        default:
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = 0x01;
+            return 3;
+    }
+
+    txBuffer[2] = rxBuffer[2];
+    txBuffer[3] = rxBuffer[3];
+    txBuffer[4] = (count >> 8) & 0xFF;
+    txBuffer[5] = count & 0xFF;
+    return 6;
+}
+
+// "v0.01" từ thanh ghi version (0x0001 = v0.01)
+static uint8_t formatVersion(char *dest, uint16_t version) {
+    uint8_t len = 0;
+    uint16_t major = version / 100;
+    char digits[5];
+    uint8_t n = 0;
+
+    dest[len++] = 'v';
+    do {
+        digits[n++] = '0' + (major % 10);
+        major /= 10;
+    } while (major > 0);
+    while (n > 0) {
+        dest[len++] = digits[--n];
+    }
+    dest[len++] = '.';
+    dest[len++] = '0' + (version % 100) / 10;
+    dest[len++] = '0' + (version % 10);
+    return len;
+}
+
+// Nội dung object; trả về 0 nếu object không tồn tại
+static uint8_t getDeviceIdObject(uint8_t objectId, char *dest) {
+    const char *str = NULL;
+
+    switch (objectId) {
+        case 0x00: str = DEVICE_VENDOR_NAME; break;
+        case 0x01: str = DEVICE_PRODUCT_CODE; break;
+        case 0x02: return formatVersion(dest, HREG(REG_FIRMWARE_VERSION));
+        case 0x04: str = DEVICE_PRODUCT_NAME; break;
+        case 0x05: str = DEVICE_MODEL_NAME; break;
+        case 0x80: return formatVersion(dest, HREG(REG_HARDWARE_VERSION));   // Hardware revision
+        default: return 0;
+    }
+    uint8_t len = (uint8_t)strlen(str);
+    memcpy(dest, str, len);
+    return len;
+}
+
+// Read Device Identification (MEI 0x0E): basic 0x00-0x02, regular 0x04-0x05, extended 0x80
+static uint16_t buildDeviceIdResponse(void) {
+    static const uint8_t objectIds[] = { 0x00, 0x01, 0x02, 0x04, 0x05, 0x80 };
+    uint8_t readCode = rxBuffer[3];
+    uint8_t objectId = rxBuffer[4];
+    uint8_t lastObject;
+
+    if (rxIndex != 7 || rxBuffer[2] != 0x0E || readCode < 1 || readCode > 4) {
+        txBuffer[1] |= 0x80;
+        txBuffer[2] = 0x03;
+        return 3;
+    }
+
+    lastObject = (readCode == 1) ? 0x02 : (readCode == 2) ? 0x7F : 0xFF;
+    if (readCode == 4) {
+        lastObject = objectId;
+    } else if (objectId > lastObject) {
+        objectId = 0x00;    // Object bắt đầu không hợp lệ -> đọc lại từ đầu (theo spec)
+    }
+
+    txBuffer[2] = 0x0E;
+    txBuffer[3] = readCode;
+    txBuffer[4] = 0x83;     // Conformity: extended, stream + individual
+    txBuffer[5] = 0x00;     // More follows: toàn bộ object vừa 1 response
+    txBuffer[6] = 0x00;
+    txBuffer[7] = 0;
+    uint16_t txIndex = 8;
+
+    for (uint8_t i = 0; i < sizeof(objectIds); i++) {
+        if (objectIds[i] < objectId || objectIds[i] > lastObject) {
+            continue;
+        }
+        uint8_t len = getDeviceIdObject(objectIds[i], (char *)&txBuffer[txIndex + 2]);
+        txBuffer[txIndex] = objectIds[i];
+        txBuffer[txIndex + 1] = len;
+        txIndex += 2 + len;
+        txBuffer[7]++;
+    }
+
+    if (txBuffer[7] == 0) {
+        txBuffer[1] |= 0x80;
+        txBuffer[2] = 0x02;
+        return 3;
+    }
+    return txIndex;
+}
+
+// FC 0x41: rút sample telemetry, nhiều nhất vừa 1 frame
+static uint16_t buildTelemetryResponse(void) {
+    uint16_t maxSamples = (rxBuffer[2] << 8) | rxBuffer[3];
+
+    if (rxIndex != 6) {
+        txBuffer[1] |= 0x80;
+        txBuffer[2] = 0x03;
+        return 3;
+    }
+    if (maxSamples == 0 || maxSamples > TELEMETRY_SAMPLES_PER_FRAME) {
+        maxSamples = TELEMETRY_SAMPLES_PER_FRAME;
+    }
+
+    uint8_t count = Telemetry_Drain(&txBuffer[5], maxSamples);
+    uint16_t pending = Telemetry_Pending();
+    txBuffer[2] = count;
+    txBuffer[3] = pending >> 8;
+    txBuffer[4] = pending & 0xFF;
+    return 5 + count * TELEMETRY_SAMPLE_BYTES;
 }
 
 void processModbusFrame(void) {
-    if (rxIndex < 6) return;
-    if (rxBuffer[0] != g_holdingRegisters[REG_DEVICE_ID]) {
+    ModbusLatency_MarkProcessStart();
+    if (rxIndex < 6) {
+        rxIndex = 0;
+        frameReceived = 0;
+        return;
+    }
+    // Địa chỉ 0 = broadcast: mọi drive cùng thực hiện, không drive nào trả lời
+    uint8_t broadcast = (rxBuffer[0] == MODBUS_BROADCAST_ADDRESS);
+    if (rxBuffer[0] != HREG(REG_DEVICE_ID) && !broadcast) {
         rxIndex = 0;
         frameReceived = 0;
         return;
     }
 
-    uint16_t crc = calcCRC(rxBuffer, rxIndex - 2);
-    if (rxBuffer[rxIndex - 2] != (crc & 0xFF) || rxBuffer[rxIndex - 1] != (crc >> 8)) {
+    // CRC đã được tính trong ISR (gồm cả 2 byte CRC) - frame đúng khi residue = 0
+    if (rxFrameCRC != MODBUS_CRC_RESIDUE) {
         rxIndex = 0;
         frameReceived = 0;
         g_corruptionCount++;
         return;
     }
+    autoBaudFramingErrors = 0;
+    g_slaveMessageCount++;
+    // Frame hợp lệ ở cấu hình UART mới - xác nhận, không revert nữa
+    if (HREG(REG_CONFIG_STATUS) == SERIAL_CONFIG_TRIAL) {
+        HREG(REG_CONFIG_STATUS) = SERIAL_CONFIG_APPLIED;
+    }
+
+    // txBuffer còn đang được DMA đọc nếu response trước chưa truyền xong
+    waitTransmitComplete();
 
     uint8_t funcCode = rxBuffer[1];
-    uint8_t txBuffer[256];
-    uint8_t txIndex = 0;
-    txBuffer[0] = g_holdingRegisters[REG_DEVICE_ID];
+    uint16_t txIndex = 0;
+    // txBuffer[0, crcIndex) đã được tính dần vào crc khi build response
+    uint16_t crc = MODBUS_CRC_INIT;
+    uint16_t crcIndex = 0;
+
+    // Broadcast chỉ hợp lệ với lệnh ghi
+    if (broadcast) {
+        if (funcCode != 5 && funcCode != 6 && funcCode != 15 && funcCode != 16) {
+            rxIndex = 0;
+            frameReceived = 0;
+            return;
+        }
+        g_broadcastCount++;
+    }
+    txBuffer[0] = HREG(REG_DEVICE_ID);
     txBuffer[1] = funcCode;
 
-    if (funcCode == 3) {
+    if (funcCode == 1 || funcCode == 2) {
+        // Read Coils / Read Discrete Inputs - trạng thái đọc trực tiếp từ GPIO
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
-        if (addr + qty <= HOLDING_REG_COUNT) {
-            txBuffer[2] = qty * 2;
+        uint16_t count = (funcCode == 1) ? COIL_COUNT : DISCRETE_COUNT;
+        if (qty == 0 || qty > MODBUS_MAX_READ_BITS) {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = 0x03;
             txIndex = 3;
-            for (int i = 0; i < qty; i++) {
-                txBuffer[txIndex++] = g_holdingRegisters[addr + i] >> 8;
-                txBuffer[txIndex++] = g_holdingRegisters[addr + i] & 0xFF;
-            }
+        } else if (addr + qty <= count) {
+            updateDigitalIOStatus();
+            txBuffer[2] = packBits((funcCode == 1) ? g_coils : g_discreteInputs, addr, qty, &txBuffer[3]);
+            txIndex = 3 + txBuffer[2];
         } else {
             txBuffer[1] |= 0x80;
             txBuffer[2] = 0x02;
             txIndex = 3;
         }
+    } else if (funcCode == 3) {
+        uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
+        uint8_t exception = 0x03;
+        if (qty != 0 && qty <= MODBUS_MAX_READ_REGISTERS) {
+            exception = checkHoldingRead(addr, qty);
+        }
+        if (exception == 0) {
+            txBuffer[2] = qty * 2;
+            crc = modbusCRCBlock(crc, txBuffer, 3);
+            txIndex = streamHoldingRegisters(3, addr, qty, &crc);
+            crcIndex = txIndex;
+        } else {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = exception;
+            txIndex = 3;
+        }
     } else if (funcCode == 4) {
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
@@ -272,13 +1257,53 @@ void processModbusFrame(void) {
     } else if (funcCode == 6) {
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t value = (rxBuffer[4] << 8) | rxBuffer[5];
-        if (addr < HOLDING_REG_COUNT) {
-            g_holdingRegisters[addr] = value;
-            
-            if (addr == REG_RESET_ERROR_COMMAND && value == 1) {
-                g_holdingRegisters[REG_SYSTEM_ERROR] = 0;
+        uint8_t exception = checkHoldingWrite(addr, 1, &rxBuffer[4]);
+        if (exception == 0) {
+            writeHoldingRegister(addr, value);
+
+            txBuffer[2] = rxBuffer[2];
+            txBuffer[3] = rxBuffer[3];
+            txBuffer[4] = rxBuffer[4];
+            txBuffer[5] = rxBuffer[5];
+            txIndex = 6;
+        } else {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = exception;
+            txIndex = 3;
+        }
+    } else if (funcCode == 5) {
+        uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t value = (rxBuffer[4] << 8) | rxBuffer[5];
+        if (value != 0xFF00 && value != 0x0000) {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = 0x03;
+            txIndex = 3;
+        } else if (addr < COIL_COUNT) {
+            writeCoil(addr, value == 0xFF00);
+
+            txBuffer[2] = rxBuffer[2];
+            txBuffer[3] = rxBuffer[3];
+            txBuffer[4] = rxBuffer[4];
+            txBuffer[5] = rxBuffer[5];
+            txIndex = 6;
+        } else {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = 0x02;
+            txIndex = 3;
+        }
+    } else if (funcCode == 15) {
+        uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
+        uint8_t byteCount = rxBuffer[6];
+        if (qty == 0 || qty > MODBUS_MAX_WRITE_BITS || byteCount != (qty + 7) / 8 ||
+            rxIndex != 9 + byteCount) {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = 0x03;
+            txIndex = 3;
+        } else if (addr + qty <= COIL_COUNT) {
+            for (int i = 0; i < qty; i++) {
+                writeCoil(addr + i, (rxBuffer[7 + (i >> 3)] >> (i & 7)) & 0x01);
             }
-            
             txBuffer[2] = rxBuffer[2];
             txBuffer[3] = rxBuffer[3];
             txBuffer[4] = rxBuffer[4];
@@ -293,9 +1318,14 @@ void processModbusFrame(void) {
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
         uint8_t byteCount = rxBuffer[6];
-        if (addr + qty <= HOLDING_REG_COUNT && byteCount == qty * 2) {
+        uint8_t exception = 0x03;
+        if (qty != 0 && qty <= MODBUS_MAX_WRITE_REGISTERS && byteCount == qty * 2 &&
+            rxIndex == 9 + byteCount) {
+            exception = checkHoldingWrite(addr, qty, &rxBuffer[7]);
+        }
+        if (exception == 0) {
             for (int i = 0; i < qty; i++) {
-                g_holdingRegisters[addr + i] = (rxBuffer[7 + i*2] << 8) | rxBuffer[8 + i*2];
+                writeHoldingRegister(addr + i, (rxBuffer[7 + i*2] << 8) | rxBuffer[8 + i*2]);
             }
             txBuffer[2] = rxBuffer[2];
             txBuffer[3] = rxBuffer[3];
@@ -304,75 +1334,256 @@ void processModbusFrame(void) {
             txIndex = 6;
         } else {
             txBuffer[1] |= 0x80;
-            txBuffer[2] = 0x02;
+            txBuffer[2] = exception;
+            txIndex = 3;
+        }
+    } else if (funcCode == 0x17) {
+        // Read/Write Multiple Registers: ghi trước, đọc sau để response phản ánh setpoint mới
+        uint16_t readAddr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t readQty = (rxBuffer[4] << 8) | rxBuffer[5];
+        uint16_t writeAddr = (rxBuffer[6] << 8) | rxBuffer[7];
+        uint16_t writeQty = (rxBuffer[8] << 8) | rxBuffer[9];
+        uint8_t byteCount = rxBuffer[10];
+        uint8_t exception = 0x03;
+        if (readQty != 0 && readQty <= MODBUS_MAX_READ_REGISTERS &&
+            writeQty != 0 && writeQty <= MODBUS_MAX_RW_WRITE_REGISTERS &&
+            byteCount == writeQty * 2 && rxIndex == 13 + byteCount) {
+            exception = checkHoldingRead(readAddr, readQty);
+            if (exception == 0) {
+                exception = checkHoldingWrite(writeAddr, writeQty, &rxBuffer[11]);
+            }
+        }
+        if (exception == 0) {
+            for (int i = 0; i < writeQty; i++) {
+                writeHoldingRegister(writeAddr + i, (rxBuffer[11 + i*2] << 8) | rxBuffer[12 + i*2]);
+            }
+            txBuffer[2] = readQty * 2;
+            crc = modbusCRCBlock(crc, txBuffer, 3);
+            txIndex = streamHoldingRegisters(3, readAddr, readQty, &crc);
+            crcIndex = txIndex;
+        } else {
+            txBuffer[1] |= 0x80;
+            txBuffer[2] = exception;
             txIndex = 3;
         }
+    } else if (funcCode == 0x08) {
+        txIndex = buildDiagnosticsResponse();
+    } else if (funcCode == 0x2B) {
+        txIndex = buildDeviceIdResponse();
+    } else if (funcCode == TELEMETRY_FUNCTION_CODE) {
+        txIndex = buildTelemetryResponse();
     } else {
         txBuffer[1] |= 0x80;
         txBuffer[2] = 0x01;
         txIndex = 3;
     }
 
-    crc = calcCRC(txBuffer, txIndex);
-    txBuffer[txIndex++] = crc & 0xFF;
-    txBuffer[txIndex++] = crc >> 8;
-    
-    // Sử dụng mutex để bảo vệ việc truyền dữ liệu
+    if (!broadcast) {
+        if (txBuffer[1] & 0x80) {
+            g_exceptionCount++;
+        }
+        crc = modbusCRCBlock(crc, &txBuffer[crcIndex], txIndex - crcIndex);
+        txBuffer[txIndex++] = crc & 0xFF;
+        txBuffer[txIndex++] = crc >> 8;
+
+        // Truyền bằng DMA - task không bị chặn trong lúc response ra dây
+        transmitResponse(txIndex);
+    }
+
+    // Reset buffer sau khi xử lý
+    rxIndex = 0;
+    frameReceived = 0;
+}
+
+// Đổi cấu hình USART2: gọi khi giữ modbusTxMutex, không có response đang truyền.
+// Parity chiếm 1 bit dữ liệu trên STM32 -> cần word length 9 bit để giữ 8 bit data.
+static void applySerialSettings(uint32_t baudrate, uint8_t parity, uint8_t stopBit) {
+    huart2.Init.BaudRate = baudrate;
+    huart2.Init.Parity = (parity == PARITY_EVEN) ? UART_PARITY_EVEN :
+                         (parity == PARITY_ODD) ? UART_PARITY_ODD : UART_PARITY_NONE;
+    huart2.Init.WordLength = (parity == PARITY_NONE) ? UART_WORDLENGTH_8B : UART_WORDLENGTH_9B;
+    huart2.Init.StopBits = (stopBit == 2) ? UART_STOPBITS_2 : UART_STOPBITS_1;
+    HAL_UART_DeInit(&huart2);
+    HAL_UART_Init(&huart2);
+    updateFrameTimers(baudrate);
+    // BRR làm tròn tới 1/16: 921600 @ PCLK1 36 MHz -> BRR 39 -> 923077 (+0.16%)
+    HREG(REG_COMM_BAUDRATE_X100) = (HAL_RCC_GetPCLK1Freq() / huart2.Instance->BRR + 50) / 100;
+}
+
+// Dừng nhận UART, bắt cạnh xuống của frame kế tiếp trên RX
+static void startAutoBaud(void) {
+    TIM_IC_InitTypeDef sConfigIC = {0};
+
+    HAL_UART_AbortReceive(&huart2);
+    __HAL_UART_DISABLE_IT(&huart2, UART_IT_IDLE);
+    stopFrameTimer();
+    rxIndex = 0;
+    frameReceived = 0;
+
+    ModbusLatency_EnableCycleCounter();
+    autoBaudEdges = 0;
+    autoBaudMinTicks = 0xFFFF;
+    autoBaudDone = 0;
+    autoBaudActive = 1;
+
+    sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_FALLING;
+    sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+    sConfigIC.ICFilter = 0;
+    HAL_TIM_IC_ConfigChannel(&htim2, &sConfigIC, TIM_CHANNEL_4);
+    HAL_TIM_IC_Start_IT(&htim2, TIM_CHANNEL_4);
+}
+
+// Gọi từ TIM2_IRQHandler trước HAL_TIM_IRQHandler (CH1 vẫn là encoder)
+void handleAutoBaudCapture(void) {
+    if (!__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_CC4) || !__HAL_TIM_GET_IT_SOURCE(&htim2, TIM_IT_CC4)) {
+        return;
+    }
+    uint16_t capture = htim2.Instance->CCR4;    // Đọc CCR4 xóa luôn CC4IF
+    uint32_t cycles = DWT->CYCCNT;
+
+    // Cạnh xuống liên tiếp cách nhau >= 2 bit (start bit + bit 1, hoặc bit 0-stop-start),
+    // khoảng nhỏ nhất trong frame = đúng 2 bit. DWT loại khoảng dài hơn 1 vòng TIM2 (16 bit).
+    if (autoBaudEdges > 0 && cycles - autoBaudLastCycles < 65000UL * (htim2.Instance->PSC + 1)) {
+        uint16_t ticks = (uint16_t)(autoBaudLastCapture - capture);     // TIM2 đếm xuống
+        if (ticks < autoBaudMinTicks) {
+            autoBaudMinTicks = ticks;
+        }
+    }
+    autoBaudLastCapture = capture;
+    autoBaudLastCycles = cycles;
+
+    if (++autoBaudEdges >= AUTOBAUD_EDGE_COUNT) {
+        __HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC4);
+        autoBaudDone = 1;
+        if (modbusTaskHandle != NULL) {
+            osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_AUTOBAUD);
+        }
+    }
+}
+
+// Gọi từ UartTask: chốt baud đo được (làm tròn về baud chuẩn gần nhất) hoặc đo lại
+void processAutoBaud(void) {
+    if (autoBaudRelock) {
+        autoBaudRelock = 0;
+        if (modbusTxMutex != NULL) {
+            osMutexAcquire(modbusTxMutex, osWaitForever);
+        }
+        waitTransmitComplete();
+        startAutoBaud();
+        if (modbusTxMutex != NULL) {
+            osMutexRelease(modbusTxMutex);
+        }
+        return;
+    }
+    if (!autoBaudDone) {
+        return;
+    }
+    autoBaudDone = 0;
+    HAL_TIM_IC_Stop_IT(&htim2, TIM_CHANNEL_4);
+
+    // TIM2 clock = 2 x PCLK1 (APB1 prescaler = 2)
+    uint32_t timerClock = HAL_RCC_GetPCLK1Freq() * 2 / (htim2.Instance->PSC + 1);
+    uint32_t measured = (autoBaudMinTicks > 0) ? (timerClock * 2) / autoBaudMinTicks : 0;
+    uint32_t locked = 0;
+    for (uint8_t code = 1; code <= BAUDRATE_CODE_MAX; code++) {
+        uint32_t diff = (measured > baudrateTable[code]) ? measured - baudrateTable[code] : baudrateTable[code] - measured;
+        if (diff * 100 <= baudrateTable[code] * AUTOBAUD_TOLERANCE_PCT) {
+            locked = baudrateTable[code];
+            break;
+        }
+    }
+    if (locked == 0) {
+        // Nhiễu hoặc frame không có cặp bit 0-1-0: đo lại ở frame sau
+        startAutoBaud();
+        return;
+    }
+
     if (modbusTxMutex != NULL) {
         osMutexAcquire(modbusTxMutex, osWaitForever);
     }
-    
-    HAL_UART_Transmit(&huart2, txBuffer, txIndex, 100);
-    
+    autoBaudActive = 0;
+    g_autoBaudRate = locked;
+    applySerialSettings(locked, currentParity, currentStopBit);
+    startDMAReception();
     if (modbusTxMutex != NULL) {
         osMutexRelease(modbusTxMutex);
     }
-    
-    
-    // Reset buffer sau khi xử lý
-    rxIndex = 0;
-    frameReceived = 0;
 }
 
-void updateBaudrate(void) {
-    if(current_baudrate == g_holdingRegisters[REG_CONFIG_BAUDRATE])
+// Gọi từ UartTask sau mỗi frame: áp dụng baud/parity/stop bit cùng lúc, sau khi
+// response xác nhận lệnh ghi đã ra hết khỏi dây. Config_Revert_Timeout > 0: nếu
+// không có frame hợp lệ nào ở cấu hình mới trong thời gian đó thì quay lại cấu hình cũ.
+void updateSerialConfig(void) {
+    uint8_t reverting = 0;
+
+    if (HREG(REG_CONFIG_STATUS) == SERIAL_CONFIG_TRIAL &&
+        (int32_t)(HAL_GetTick() - serialTrialDeadline) >= 0) {
+        HREG(REG_CONFIG_BAUDRATE) = previousSerialConfig[0];
+        HREG(REG_CONFIG_PARITY) = previousSerialConfig[1];
+        HREG(REG_CONFIG_STOP_BIT) = previousSerialConfig[2];
+        markRegistersDirty(REG_CONFIG_BAUDRATE, 3);
+        reverting = 1;
+    }
+
+    // Giá trị không hợp lệ được sửa ngay trong thanh ghi để master đọc lại thấy
+    if (HREG(REG_CONFIG_BAUDRATE) > BAUDRATE_CODE_MAX) {
+        HREG(REG_CONFIG_BAUDRATE) = DEFAULT_CONFIG_BAUDRATE;
+        markRegistersDirty(REG_CONFIG_BAUDRATE, 1);
+    }
+    if (HREG(REG_CONFIG_PARITY) > PARITY_ODD) {
+        HREG(REG_CONFIG_PARITY) = DEFAULT_CONFIG_PARITY;
+        markRegistersDirty(REG_CONFIG_PARITY, 1);
+    }
+    if (HREG(REG_CONFIG_STOP_BIT) != 1 && HREG(REG_CONFIG_STOP_BIT) != 2) {
+        HREG(REG_CONFIG_STOP_BIT) = DEFAULT_CONFIG_STOP_BIT;
+        markRegistersDirty(REG_CONFIG_STOP_BIT, 1);
+    }
+
+    uint8_t code = HREG(REG_CONFIG_BAUDRATE);
+    uint8_t parity = HREG(REG_CONFIG_PARITY);
+    uint8_t stopBit = HREG(REG_CONFIG_STOP_BIT);
+    if (code == current_baudrate && parity == currentParity && stopBit == currentStopBit) {
         return;
-    
+    }
+
     if (modbusTxMutex != NULL) {
         osMutexAcquire(modbusTxMutex, osWaitForever);
     }
-    
-    switch(g_holdingRegisters[REG_CONFIG_BAUDRATE]) {
-        case 1:
-            current_baudrate = 1;
-            huart2.Init.BaudRate = 9600;
-            break;
-        case 2:
-            current_baudrate = 2;
-            huart2.Init.BaudRate = 19200;
-            break;
-        case 3:
-            current_baudrate = 3;
-            huart2.Init.BaudRate = 38400;
-            break;
-        case 4:
-            current_baudrate = 4;
-            huart2.Init.BaudRate = 57600;
-            break;
-        case 5:
-            current_baudrate = 5;
-            huart2.Init.BaudRate = 115200;
-            break;
-        default:
-            current_baudrate = 5;
-            huart2.Init.BaudRate = 115200;
-            break;
+
+    // Không DeInit UART khi response đang truyền bằng DMA
+    waitTransmitComplete();
+
+    previousSerialConfig[0] = current_baudrate;
+    previousSerialConfig[1] = currentParity;
+    previousSerialConfig[2] = currentStopBit;
+    current_baudrate = code;
+    currentParity = parity;
+    currentStopBit = stopBit;
+
+    if (code == BAUDRATE_CODE_AUTO) {
+        // Giữ baud hiện tại cho tới khi đo xong frame đầu tiên của master
+        applySerialSettings(huart2.Init.BaudRate, parity, stopBit);
+        startAutoBaud();
+    } else {
+        if (autoBaudActive) {
+            HAL_TIM_IC_Stop_IT(&htim2, TIM_CHANNEL_4);
+            autoBaudActive = 0;
+            autoBaudDone = 0;
+        }
+        applySerialSettings(baudrateTable[code], parity, stopBit);
+        startDMAReception();
     }
-    
-    HAL_UART_DeInit(&huart2);
-    HAL_UART_Init(&huart2);
-    HAL_UART_Receive_IT(&huart2, &rxByte, 1);
-    
+
+    if (reverting) {
+        HREG(REG_CONFIG_STATUS) = SERIAL_CONFIG_REVERTED;
+    } else if (HREG(REG_CONFIG_REVERT_TIMEOUT) != 0) {
+        serialTrialDeadline = HAL_GetTick() + HREG(REG_CONFIG_REVERT_TIMEOUT) * 1000UL;
+        HREG(REG_CONFIG_STATUS) = SERIAL_CONFIG_TRIAL;
+    } else {
+        HREG(REG_CONFIG_STATUS) = SERIAL_CONFIG_APPLIED;
+    }
+
     if (modbusTxMutex != NULL) {
         osMutexRelease(modbusTxMutex);
     }
@@ -394,9 +1605,49 @@ void checkUARTHealth(void) {
 }
 
 void startModbusUARTReception(void) {
-    // Bắt đầu nhận UART vào rxByte
-    // Gọi hàm này SAU KHI RTOS đã start
+    // Bắt đầu nhận UART bằng circular DMA + IDLE line
+    // Gọi hàm này SAU KHI RTOS đã start, từ chính task xử lý Modbus
+    modbusTaskHandle = osThreadGetId();
+    ModbusLatency_Init();
     g_lastUARTActivity = HAL_GetTick();
     last_health_check = g_lastUARTActivity;
-    HAL_UART_Receive_IT(&huart2, &rxByte, 1);
+    updateFrameTimers(huart2.Init.BaudRate);
+    HREG(REG_COMM_BAUDRATE_X100) = (HAL_RCC_GetPCLK1Freq() / huart2.Instance->BRR + 50) / 100;
+    __HAL_TIM_ENABLE_IT(&htim4, TIM_IT_UPDATE | TIM_IT_CC1);
+    setDriverEnable(0);
+    startDMAReception();
+}
+
+void updateDigitalIOStatus(void) {
+    uint16_t diWord = 0;
+
+    g_discreteInputs[0] = (HAL_GPIO_ReadPin(IN1_GPIO_Port, IN1_Pin) == GPIO_PIN_SET);
+    g_discreteInputs[1] = (HAL_GPIO_ReadPin(IN2_GPIO_Port, IN2_Pin) == GPIO_PIN_SET);
+    g_discreteInputs[2] = (HAL_GPIO_ReadPin(IN3_GPIO_Port, IN3_Pin) == GPIO_PIN_SET);
+    for (int i = 0; i < DISCRETE_COUNT; i++) {
+        if (g_discreteInputs[i]) {
+            diWord |= (1U << i);
+        }
+    }
+    HREG(REG_DI_STATUS_WORD) = diWord;
+
+    // Coil relay phản ánh ngõ ra thực tế (DOx_Control OR chức năng tự động)
+    g_coils[COIL_OUT1] = doutput_state.relay1;
+    g_coils[COIL_OUT2] = doutput_state.relay2;
+    g_coils[COIL_M1_ENABLE] = (HREG(REG_M1_ENABLE) != 0);
+    g_coils[COIL_M2_ENABLE] = (HREG(REG_M2_ENABLE) != 0);
+}
+
+void updateCommDiagnostics(void) {
+    HREG(REG_COMM_FRAME_COUNT) = (uint16_t)g_totalReceived;
+    HREG(REG_COMM_LAST_FRAME_BYTES) = g_lastFrameBytes;
+    HREG(REG_COMM_MAX_FRAME_BYTES) = g_maxFrameBytes;
+    HREG(REG_COMM_OVERRUN_COUNT) = (uint16_t)g_overrunCount;
+    HREG(REG_COMM_UART_ERROR_COUNT) = (uint16_t)g_uartErrorCount;
+    HREG(REG_COMM_CRC_ERROR_COUNT) = (uint16_t)g_corruptionCount;
+    HREG(REG_COMM_T15_US) = g_t15Us;
+    HREG(REG_COMM_T35_US) = g_t35Us;
+    HREG(REG_COMM_T15_VIOLATION_COUNT) = (uint16_t)g_t15ViolationCount;
+    ModbusLatency_UpdateRegisters();
+    Telemetry_UpdateRegisters();
 }
\ No newline at end of file
@@ -53,9 +53,12 @@ I2C_HandleTypeDef hi2c1;
 TIM_HandleTypeDef htim1;
 TIM_HandleTypeDef htim2;
 TIM_HandleTypeDef htim3;
+TIM_HandleTypeDef htim4;
 DMA_HandleTypeDef hdma_tim2_ch1;
 
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 uint8_t current_baudrate = DEFAULT_CONFIG_BAUDRATE;
 /* Definitions for IOTask */
@@ -77,7 +80,7 @@ osThreadId_t MotorTaskHandle;
 const osThreadAttr_t MotorTask_attributes = {
   .name = "MotorTask",
   .stack_size = 128 * 4,
-  .priority = (osPriority_t) osPriorityNormal,
+  .priority = (osPriority_t) osPriorityRealtime,
 };
 /* Definitions for VisibleTask */
 osThreadId_t VisibleTaskHandle;
@@ -107,6 +110,7 @@ static void MX_TIM2_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_TIM1_Init(void);
 static void MX_TIM3_Init(void);
+static void MX_TIM4_Init(void);
 void StartIOTask(void *argument);
 void StartUartTask(void *argument);
 void StartMotorTask(void *argument);
@@ -154,6 +158,7 @@ int main(void)
   MX_USART2_UART_Init();
   MX_TIM1_Init();
   MX_TIM3_Init();
+  MX_TIM4_Init();
   /* USER CODE BEGIN 2 */
 
   // Start PWM timers for motor control
@@ -502,6 +507,68 @@ static void MX_TIM3_Init(void)
 
 }
 
+/**
+  * @brief TIM4 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_TIM4_Init(void)
+{
+
+  /* USER CODE BEGIN TIM4_Init 0 */
+
+  /* USER CODE END TIM4_Init 0 */
+
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+  TIM_OC_InitTypeDef sConfigOC = {0};
+
+  /* USER CODE BEGIN TIM4_Init 1 */
+
+  /* USER CODE END TIM4_Init 1 */
+  htim4.Instance = TIM4;
+  htim4.Init.Prescaler = 71;
+  htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim4.Init.Period = 65535;
+  htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim4) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim4, &sClockSourceConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_TIM_OC_Init(&htim4) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_TIM_OnePulse_Init(&htim4, TIM_OPMODE_SINGLE) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim4, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sConfigOC.OCMode = TIM_OCMODE_TIMING;
+  sConfigOC.Pulse = 0;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  if (HAL_TIM_OC_ConfigChannel(&htim4, &sConfigOC, TIM_CHANNEL_1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN TIM4_Init 2 */
+
+  /* USER CODE END TIM4_Init 2 */
+
+}
+
 /**
   * @brief USART2 Initialization Function
   * @param None
@@ -548,6 +615,12 @@ static void MX_DMA_Init(void)
   /* DMA1_Channel5_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Channel5_IRQn, 5, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+  /* DMA1_Channel6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+  /* DMA1_Channel7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
 
 }
 
@@ -573,7 +646,7 @@ static void MX_GPIO_Init(void)
   HAL_GPIO_WritePin(GPIOC, LED4_Pin|LED3_Pin|LED2_Pin, GPIO_PIN_RESET);
 
   /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(GPIOA, DIR_1_Pin|DIR_3_Pin, GPIO_PIN_RESET);
+  HAL_GPIO_WritePin(GPIOA, RS485_DE_Pin|DIR_1_Pin|DIR_3_Pin, GPIO_PIN_RESET);
 
   /*Configure GPIO pin Output Level */
   HAL_GPIO_WritePin(GPIOB, DIR_2_Pin|DIR_4_Pin|OUT2_Pin|OUT1_Pin, GPIO_PIN_RESET);
@@ -585,8 +658,8 @@ static void MX_GPIO_Init(void)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
 
-  /*Configure GPIO pins : DIR_1_Pin DIR_3_Pin */
-  GPIO_InitStruct.Pin = DIR_1_Pin|DIR_3_Pin;
+  /*Configure GPIO pins : RS485_DE_Pin DIR_1_Pin DIR_3_Pin */
+  GPIO_InitStruct.Pin = RS485_DE_Pin|DIR_1_Pin|DIR_3_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
@@ -637,6 +710,7 @@ void StartIOTask(void *argument)
     DOutput_Load(&doutput_state);
     DOutput_Process(&doutput_state);
     DOutput_Save(&doutput_state);
+    updateDigitalIOStatus();
     g_taskCounter++;
     
     // Update input registers periodically (simulate sensor data)
@@ -662,36 +736,29 @@ void StartUartTask(void *argument)
   /* Infinite loop */
 	startModbusUARTReception();
 
-  // Tính toán thời gian timeout dựa trên baudrate
-  uint32_t charTime = (11 * 1000) / huart2.Init.BaudRate; // 11 bit per char (8N1 + start/stop)
-  uint32_t frameTimeout = charTime * 4; // 3.5 char time for Modbus RTU
-  uint32_t previousTick = osKernelGetTickCount();
-  if (frameTimeout < 5) frameTimeout = 5; // Tối thiểu 5ms
-
   /* Infinite loop */
   for(;;) {
 
+	// Chờ ISR báo có frame (IDLE line) - timeout để vẫn kiểm tra sức khỏe UART khi bus im lặng
+	osThreadFlagsWait(MODBUS_FLAG_FRAME_READY | MODBUS_FLAG_AUTOBAUD, osFlagsWaitAny, UART_HEALTH_CHECK_INTERVAL);
+
 	g_modbusCounter++;
 
-	// Xử lý frame đã nhận đủ
+	// Auto-baud (Config_Baudrate = 0): chốt baud đã đo hoặc đo lại
+	processAutoBaud();
+
+	// Xử lý frame đã nhận đủ (frame được tách bởi IDLE line trong ISR)
 	if (frameReceived) {
 		processModbusFrame();
 	}
 
-	// Kiểm tra timeout cho frame chưa hoàn chỉnh
-	// Nếu có dữ liệu trong buffer nhưng chưa đủ frame và đã timeout
-	if (!frameReceived && rxIndex > 0 && (HAL_GetTick() - g_lastUARTActivity > frameTimeout)) {
-		// Frame không hoàn chỉnh và đã timeout - bỏ qua và reset
-		rxIndex = 0;
-		frameReceived = 0;
-		g_corruptionCount++;
-	}
+	// Đổi baud/parity/stop bit (nếu master vừa ghi) sau khi response đã truyền xong
+	updateSerialConfig();
+
+	updateCommDiagnostics();
 
 	// Kiểm tra sức khỏe UART định kỳ
 	checkUARTHealth();
-
-	// Delay 1ms
-	osDelayUntil(previousTick += 10);
   }
   /* USER CODE END StartUartTask */
 }
@@ -707,7 +774,6 @@ void StartMotorTask(void *argument)
 {
   /* USER CODE BEGIN StartMotorTask */
   /* Infinite loop */
-  uint32_t previousTick = osKernelGetTickCount();
   const uint16_t M1_BASE_ADDR = 0x0000;
   const uint16_t M2_BASE_ADDR = 0x0010;
   const uint16_t SYS_BASE_ADDR = 0x0100;
@@ -716,18 +782,29 @@ void StartMotorTask(void *argument)
 
   // Initialize PID controllers with default values
 
+  // Nhịp từ TIM3 CC4 ở Control_Rate_Hz (0x0124), mặc định 1 kHz
+  ControlLoop_Start();
 
   // Vòng lặp RTOS
   for (;;)
   {
-	  // 1. Load dữ liệu từ Modbus registers
-	  MotorRegisters_Load(&motor1, M1_BASE_ADDR);
-	  MotorRegisters_Load(&motor2, M2_BASE_ADDR);
-	  SystemRegisters_Load(&system);
+	  // 0. Chờ tick vòng điều khiển, PID dùng dt đo được
+	  ControlLoop_WaitTick();
+	  Encoder_UpdateSpeed();
+
+	  // 1. Load dữ liệu từ Modbus registers - chỉ block có thanh ghi master vừa ghi
+	  if (consumeDirtyRegisters(M1_BASE_ADDR, MOTOR_REG_BLOCK_COUNT)) {
+		  MotorRegisters_Load(&motor1, M1_BASE_ADDR);
+	  }
+	  if (consumeDirtyRegisters(M2_BASE_ADDR, MOTOR_REG_BLOCK_COUNT)) {
+		  MotorRegisters_Load(&motor2, M2_BASE_ADDR);
+	  }
+	  if (consumeDirtyRegisters(SYS_BASE_ADDR, SYSTEM_REG_BLOCK_COUNT)) {
+		  SystemRegisters_Load(&system);
+	  }
 	  if(system.Reset_Error_Command == 1){
 		System_ResetSystem();
 	  }
-	  updateBaudrate();
 	  // 2. Xử lý logic điều khiển motor 1
 	  Motor_ProcessControl(&motor1);
 
@@ -739,8 +816,8 @@ void StartMotorTask(void *argument)
 	  MotorRegisters_Save(&motor2, M2_BASE_ADDR);
 	  SystemRegisters_Save(&system);
 
-	  // 5. Delay theo chu kỳ task (ví dụ 10ms)
-	  osDelayUntil(previousTick += 30);
+	  // 5. Chốt snapshot cho FC3/FC23 (cùng 1 chu kỳ điều khiển)
+	  publishProcessImage();
   }
   /* USER CODE END StartMotorTask */
 }
@@ -784,9 +861,14 @@ void StartEncoderTask(void *argument)
   uint32_t previousTick = osKernelGetTickCount();
   for(;;)
   {
-    Encoder_Load(&encoder1);
+    if (consumeDirtyRegisters(REG_ENCODER_STATUS_WORD, ENCODER_REG_BLOCK_COUNT)) {
+      Encoder_Load(&encoder1);
+    }
     Encoder_Process(&encoder1);
+    // MotorTask không publish snapshot giữa chừng Encoder_Save
+    osKernelLock();
     Encoder_Save(&encoder1);
+    osKernelUnlock();
     osDelayUntil(previousTick += 10);
   }
   /* USER CODE END StartEncoderTask */
@@ -8,7 +8,11 @@ C_SRCS += \
 ../Core/Src/DInput.c \
 ../Core/Src/DOutput.c \
 ../Core/Src/Encoder.c \
+../Core/Src/ModbusCRC.c \
+../Core/Src/ModbusLatency.c \
+../Core/Src/MotionProfile.c \
 ../Core/Src/MotorControl.c \
+../Core/Src/Telemetry.c \
 ../Core/Src/UartModbus.c \
 ../Core/Src/Visible.c \
 ../Core/Src/freertos.c \
@@ -23,7 +27,11 @@ OBJS += \
 ./Core/Src/DInput.o \
 ./Core/Src/DOutput.o \
 ./Core/Src/Encoder.o \
+./Core/Src/ModbusCRC.o \
+./Core/Src/ModbusLatency.o \
+./Core/Src/MotionProfile.o \
 ./Core/Src/MotorControl.o \
+./Core/Src/Telemetry.o \
 ./Core/Src/UartModbus.o \
 ./Core/Src/Visible.o \
 ./Core/Src/freertos.o \
@@ -38,7 +46,11 @@ C_DEPS += \
 ./Core/Src/DInput.d \
 ./Core/Src/DOutput.d \
 ./Core/Src/Encoder.d \
+./Core/Src/ModbusCRC.d \
+./Core/Src/ModbusLatency.d \
+./Core/Src/MotionProfile.d \
 ./Core/Src/MotorControl.d \
+./Core/Src/Telemetry.d \
 ./Core/Src/UartModbus.d \
 ./Core/Src/Visible.d \
 ./Core/Src/freertos.d \
@@ -57,7 +69,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/DInput.cyclo ./Core/Src/DInput.d ./Core/Src/DInput.o ./Core/Src/DInput.su ./Core/Src/DOutput.cyclo ./Core/Src/DOutput.d ./Core/Src/DOutput.o ./Core/Src/DOutput.su ./Core/Src/Encoder.cyclo ./Core/Src/Encoder.d ./Core/Src/Encoder.o ./Core/Src/Encoder.su ./Core/Src/MotorControl.cyclo ./Core/Src/MotorControl.d ./Core/Src/MotorControl.o ./Core/Src/MotorControl.su ./Core/Src/UartModbus.cyclo ./Core/Src/UartModbus.d ./Core/Src/UartModbus.o ./Core/Src/UartModbus.su ./Core/Src/Visible.cyclo ./Core/Src/Visible.d ./Core/Src/Visible.o ./Core/Src/Visible.su ./Core/Src/freertos.cyclo ./Core/Src/freertos.d ./Core/Src/freertos.o ./Core/Src/freertos.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su
+	-$(RM) ./Core/Src/DInput.cyclo ./Core/Src/DInput.d ./Core/Src/DInput.o ./Core/Src/DInput.su ./Core/Src/DOutput.cyclo ./Core/Src/DOutput.d ./Core/Src/DOutput.o ./Core/Src/DOutput.su ./Core/Src/Encoder.cyclo ./Core/Src/Encoder.d ./Core/Src/Encoder.o ./Core/Src/Encoder.su ./Core/Src/ModbusCRC.cyclo ./Core/Src/ModbusCRC.d ./Core/Src/ModbusCRC.o ./Core/Src/ModbusCRC.su ./Core/Src/ModbusLatency.cyclo ./Core/Src/ModbusLatency.d ./Core/Src/ModbusLatency.o ./Core/Src/ModbusLatency.su ./Core/Src/MotionProfile.cyclo ./Core/Src/MotionProfile.d ./Core/Src/MotionProfile.o ./Core/Src/MotionProfile.su ./Core/Src/MotorControl.cyclo ./Core/Src/MotorControl.d ./Core/Src/MotorControl.o ./Core/Src/MotorControl.su ./Core/Src/Telemetry.cyclo ./Core/Src/Telemetry.d ./Core/Src/Telemetry.o ./Core/Src/Telemetry.su ./Core/Src/UartModbus.cyclo ./Core/Src/UartModbus.d ./Core/Src/UartModbus.o ./Core/Src/UartModbus.su ./Core/Src/Visible.cyclo ./Core/Src/Visible.d ./Core/Src/Visible.o ./Core/Src/Visible.su ./Core/Src/freertos.cyclo ./Core/Src/freertos.d ./Core/Src/freertos.o ./Core/Src/freertos.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su
 
 .PHONY: clean-Core-2f-Src
 
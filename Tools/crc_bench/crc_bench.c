@@ -0,0 +1,129 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST BENCHMARK: CRC-16/MODBUS bit-by-bit vs table-driven (ModbusCRC.c)
+// ═══════════════════════════════════════════════════════════════════════════════
+// Build & run (Linux, từ thư mục gốc project):
+//   gcc -O2 -ICore/Inc Tools/crc_bench/crc_bench.c Core/Src/ModbusCRC.c -o crc_bench
+//   ./crc_bench          // bảng rút gọn
+//   ./crc_bench -a       // in tất cả kích thước frame 1..256 byte
+//
+// - Kiểm tra 2 implementation cho kết quả giống nhau với mọi độ dài 1..256
+// - Kiểm tra residue: CRC chạy qua cả frame + 2 byte CRC phải bằng MODBUS_CRC_RESIDUE
+// - Đo ns/frame cho từng kích thước (số tuyệt đối là của CPU host, tỉ lệ mới có ý nghĩa)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#include "ModbusCRC.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_FRAME_SIZE      256
+#define BENCH_MIN_NS        2000000ULL  // Chạy mỗi kích thước tối thiểu 2 ms
+
+// Implementation cũ (bit-by-bit) giữ nguyên từ UartModbus.c để so sánh
+static uint16_t calcCRC_bitwise(uint8_t *buf, int len) {
+    uint16_t crc = 0xFFFF;
+    for (int pos = 0; pos < len; pos++) {
+        crc ^= (uint16_t)buf[pos];
+        for (int i = 8; i != 0; i--) {
+            if ((crc & 0x0001) != 0) {
+                crc >>= 1;
+                crc ^= 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Ngăn compiler bỏ vòng lặp benchmark
+static volatile uint16_t sink;
+
+static double bench(uint16_t (*fn)(uint8_t *, int), uint8_t *buf, int len) {
+    uint64_t iterations = 0;
+    uint64_t batch = 64;
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        for (uint64_t i = 0; i < batch; i++) {
+            buf[0] = (uint8_t)i;
+            sink = fn(buf, len);
+        }
+        iterations += batch;
+        elapsed = now_ns() - start;
+        if (batch < 65536) {
+            batch *= 2;
+        }
+    } while (elapsed < BENCH_MIN_NS);
+    return (double)elapsed / (double)iterations;
+}
+
+static int verify(uint8_t *buf) {
+    for (int len = 1; len <= MAX_FRAME_SIZE; len++) {
+        uint16_t expected = calcCRC_bitwise(buf, len);
+        uint16_t actual = calcCRC(buf, len);
+        if (expected != actual) {
+            printf("MISMATCH len=%d bitwise=0x%04X table=0x%04X\n", len, expected, actual);
+            return 0;
+        }
+
+        // Incremental + residue (cách ISR kiểm tra frame)
+        uint8_t frame[MAX_FRAME_SIZE + 2];
+        memcpy(frame, buf, (size_t)len);
+        frame[len] = expected & 0xFF;
+        frame[len + 1] = expected >> 8;
+        uint16_t crc = MODBUS_CRC_INIT;
+        for (int i = 0; i < len + 2; i++) {
+            crc = modbusCRCUpdate(crc, frame[i]);
+        }
+        if (crc != MODBUS_CRC_RESIDUE) {
+            printf("RESIDUE FAIL len=%d residue=0x%04X\n", len, crc);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int is_summary_size(int len) {
+    return len == 8 || len == 16 || len == 32 || len == 64 ||
+           len == 128 || len == 255 || len == 256;
+}
+
+int main(int argc, char **argv) {
+    int printAll = (argc > 1 && strcmp(argv[1], "-a") == 0);
+    uint8_t buf[MAX_FRAME_SIZE];
+
+    srand(12345);
+    for (int i = 0; i < MAX_FRAME_SIZE; i++) {
+        buf[i] = (uint8_t)rand();
+    }
+
+    if (!verify(buf)) {
+        return 1;
+    }
+    printf("verify: table == bitwise for len 1..%d, residue OK\n\n", MAX_FRAME_SIZE);
+
+    printf("%6s %14s %14s %9s\n", "bytes", "bitwise ns", "table ns", "speedup");
+    double totalOld = 0.0;
+    double totalNew = 0.0;
+    for (int len = 1; len <= MAX_FRAME_SIZE; len++) {
+        double oldNs = bench(calcCRC_bitwise, buf, len);
+        double newNs = bench(calcCRC, buf, len);
+        totalOld += oldNs;
+        totalNew += newNs;
+        if (printAll || is_summary_size(len)) {
+            printf("%6d %14.1f %14.1f %8.2fx\n", len, oldNs, newNs, oldNs / newNs);
+        }
+    }
+    printf("\nall sizes 1..%d: bitwise %.1f ns, table %.1f ns, speedup %.2fx\n",
+           MAX_FRAME_SIZE, totalOld, totalNew, totalOld / totalNew);
+    return 0;
+}
@@ -0,0 +1,552 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST STUB: HAL / CMSIS-RTOS2 cho drive mô phỏng (Tools/modbus_sim)
+// ═══════════════════════════════════════════════════════════════════════════════
+// - USART2 RX: sim_drive.c đẩy byte từ pty vào buffer DMA vòng (sim_uartFeed),
+//   CNDTR giảm như DMA thật nên getDMAWritePos() của firmware dùng được nguyên.
+// - USART2 TX: HAL_UART_Transmit_DMA giữ frame, sau đúng thời gian truyền 11 bit/ký
+//   tự ở baud hiện tại sim_uartService mới ghi ra pty và gọi callback TC - master
+//   nhận byte cuối cùng lúc với drive thật.
+// - DWT->CYCCNT chạy theo CLOCK_MONOTONIC quy về SystemCoreClock = 72 MHz.
+// - TIM3 đếm tự do theo cùng đồng hồ; sim_tim3Compare báo mốc CC4 cho nhịp MotorTask.
+// - Thread flag tách theo "thread" sim_drive.c đang chạy (sim_setThread).
+// - Motor 1 là khâu quán tính bậc 1 theo duty CH1 của TIM3; sim_encoderService phát
+//   cạnh xuống encoder vào buffer DMA của TIM2_CH1 (giá trị capture = CNT đếm xuống).
+//   Ngắt update/CC3 của TIM2 (mở rộng trục thời gian encoder) chạy đúng thời điểm
+//   mô phỏng xen giữa các cạnh, không phụ thuộc host ngủ quá giờ.
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#include "sim.h"
+#include "main.h"
+#include "UartModbus.h"
+#include "ModbusMap.h"
+#include "Encoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+uint32_t SystemCoreClock = 72000000U;
+
+GPIO_TypeDef sim_gpioA, sim_gpioB, sim_gpioC;
+TIM_TypeDef sim_tim1, sim_tim2, sim_tim3, sim_tim4;
+USART_TypeDef sim_usart2;
+CoreDebug_Type sim_coreDebug;
+
+TIM_HandleTypeDef htim1 = { .Instance = TIM1 };
+TIM_HandleTypeDef htim2 = { .Instance = TIM2 };
+TIM_HandleTypeDef htim3 = { .Instance = TIM3 };
+TIM_HandleTypeDef htim4 = { .Instance = TIM4 };
+UART_HandleTypeDef huart2;
+I2C_HandleTypeDef hi2c1;
+uint8_t current_baudrate = DEFAULT_CONFIG_BAUDRATE;
+
+static DMA_Channel_TypeDef dmaUsart2Rx, dmaTim2Ch1;
+static DMA_HandleTypeDef hdmaUsart2Rx = { .Instance = &dmaUsart2Rx };
+static DMA_HandleTypeDef hdmaTim2Ch1 = { .Instance = &dmaTim2Ch1 };
+
+static DWT_Type dwt;
+static uint32_t primask = 0;
+static uint32_t threadFlags[SIM_THREAD_COUNT];
+static uint8_t currentThread = SIM_THREAD_UART;
+static uint8_t mutexDummy;
+static uint64_t tim3Ticks = 0;      // Vị trí counter TIM3 (không vòng) lần cập nhật trước
+
+// Motor 1 + encoder (tốc độ tỉ lệ duty, trừ tải -L)
+#define SIM_MOTOR_RPM_PER_PERCENT   1.5     // 150 RPM ở 100% = DEFAULT_RATED_SPEED_RPM
+#define SIM_MOTOR_TAU_US            80000.0
+#define SIM_ENCODER_PPR             8       // = Revolutions mặc định
+#define SIM_MOTOR_STEP_US           100
+
+static uint16_t *captureBuffer = NULL;
+static uint16_t captureLength = 0;
+static uint8_t motorLoadPercent = 0;
+static double motorRpm = 0.0;
+static double encoderPosition = 0.0;   // Đơn vị: xung
+static uint64_t motorLastUs = 0;
+
+static int uartFd = -1;
+static uint8_t txWire[256];         // Frame đang "trên dây", ra pty cùng lúc ngắt TC
+static uint16_t txWireLength = 0;
+static uint64_t txDoneAtUs = 0;     // 0 = không có TX đang chạy
+static uint64_t postGuardAtUs = 0;  // UPDATE của TIM4 khi đếm post guard RS-485, 0 = không chạy
+static uint32_t txByteCount = 0;
+
+// ─── Đồng hồ ─────────────────────────────────────────────────────────────────
+uint64_t sim_nowUs(void) {
+    static uint64_t startUs = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t us = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    if (startUs == 0) {
+        startUs = us;
+    }
+    return us - startUs;
+}
+
+static void sleepUntilUs(uint64_t targetUs) {
+    uint64_t now = sim_nowUs();
+    if (targetUs > now) {
+        struct timespec ts = {
+            .tv_sec = (targetUs - now) / 1000000ULL,
+            .tv_nsec = ((targetUs - now) % 1000000ULL) * 1000
+        };
+        nanosleep(&ts, NULL);
+    }
+}
+
+DWT_Type *sim_dwt(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    // Chỉ cần đúng modulo 2^32 như CYCCNT thật
+    dwt.CYCCNT = (uint32_t)((uint64_t)ts.tv_sec * SystemCoreClock +
+                            (uint64_t)ts.tv_nsec * (SystemCoreClock / 1000000U) / 1000U);
+    return &dwt;
+}
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(sim_nowUs() / 1000U);
+}
+
+void HAL_Delay(uint32_t ms) {
+    sleepUntilUs(sim_nowUs() + (uint64_t)ms * 1000U);
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return SystemCoreClock / 2U;
+}
+
+// ─── Core ────────────────────────────────────────────────────────────────────
+uint32_t __get_PRIMASK(void) {
+    return primask;
+}
+
+void __set_PRIMASK(uint32_t value) {
+    primask = value;
+}
+
+void __disable_irq(void) {
+    primask = 1;
+}
+
+void __enable_irq(void) {
+    primask = 0;
+}
+
+// ─── GPIO ────────────────────────────────────────────────────────────────────
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+    return (port->IDR & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin) {
+    port->ODR ^= pin;
+}
+
+// ─── TIM ─────────────────────────────────────────────────────────────────────
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel) {
+    htim->Instance->CCER |= TIM_CCER_CC1E << channel;
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+// Như HAL thật: counter chỉ dừng khi không còn kênh nào bật CCxE
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t channel) {
+    htim->Instance->CCER &= ~(TIM_CCER_CC1E << channel);
+    if ((htim->Instance->CCER & TIM_CCER_CCxE_MASK) == 0) {
+        htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Start_IT(TIM_HandleTypeDef *htim, uint32_t channel) {
+    htim->Instance->DIER |= TIM_IT_CC1 << (channel >> 2);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Stop_IT(TIM_HandleTypeDef *htim, uint32_t channel) {
+    htim->Instance->DIER &= ~(TIM_IT_CC1 << (channel >> 2));
+    return HAL_OK;
+}
+
+// Buffer firmware là uint16_t (DMA halfword) dù prototype HAL là uint32_t *
+HAL_StatusTypeDef HAL_TIM_IC_Start_DMA(TIM_HandleTypeDef *htim, uint32_t channel, uint32_t *data, uint16_t length) {
+    (void)channel;
+    captureBuffer = (uint16_t *)data;
+    captureLength = length;
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    htim->hdma[TIM_DMA_ID_CC1]->Instance->CNDTR = length;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t channel) {
+    (void)htim;
+    (void)channel;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_IC_InitTypeDef *config, uint32_t channel) {
+    (void)htim;
+    (void)config;
+    (void)channel;
+    return HAL_OK;
+}
+
+// ─── USART2 ──────────────────────────────────────────────────────────────────
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+    huart->Instance->BRR = (HAL_RCC_GetPCLK1Freq() + huart->Init.BaudRate / 2) / huart->Init.BaudRate;
+    huart->gState = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->ErrorCode = HAL_UART_ERROR_NONE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart) {
+    huart->Instance->CR1 = 0;
+    huart->gState = HAL_UART_STATE_RESET;
+    huart->RxState = HAL_UART_STATE_RESET;
+    txDoneAtUs = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size) {
+    huart->pRxBuffPtr = data;
+    huart->RxXferSize = size;
+    huart->hdmarx->Instance->CNDTR = size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size) {
+    if (txDoneAtUs != 0) {
+        return HAL_BUSY;
+    }
+    if (size > sizeof(txWire)) {
+        return HAL_ERROR;
+    }
+    memcpy(txWire, data, size);
+    txWireLength = size;
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    // Ngắt TC đến khi ký tự cuối ra khỏi shift register
+    txDoneAtUs = sim_nowUs() + ((uint64_t)size * 11U * 1000000U + huart->Init.BaudRate - 1) / huart->Init.BaudRate;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart) {
+    huart->gState = HAL_UART_STATE_READY;
+    txDoneAtUs = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart) {
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart) {
+    HAL_UART_AbortTransmit(huart);
+    return HAL_UART_AbortReceive(huart);
+}
+
+// ─── CMSIS-RTOS2 (1 thread, các task chạy tuần tự trong sim_drive.c) ─────────
+osThreadId_t osThreadGetId(void) {
+    return &threadFlags[currentThread];
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread, uint32_t flags) {
+    uint32_t *threadFlagsPtr = thread;
+    *threadFlagsPtr |= flags;
+    return *threadFlagsPtr;
+}
+
+// Chỉ waitTransmitComplete() chờ thật: ngủ tới ngắt TC đã hẹn thay vì block.
+// Tick của MotorTask: sim_drive.c chỉ gọi ControlLoop_WaitTick khi flag đã có.
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    (void)options;
+    uint32_t *own = &threadFlags[currentThread];
+    uint64_t deadline = sim_nowUs() + (uint64_t)timeout * 1000U;
+    while ((*own & flags) == 0 && (txDoneAtUs != 0 || postGuardAtUs != 0) && sim_nowUs() < deadline) {
+        uint64_t next = (txDoneAtUs != 0) ? txDoneAtUs : postGuardAtUs;
+        sleepUntilUs(next < deadline ? next : deadline);
+        sim_uartService();
+    }
+    uint32_t set = *own & flags;
+    if (set == 0) {
+        return osFlagsErrorTimeout;
+    }
+    *own &= ~set;
+    return set;
+}
+
+osMutexId_t osMutexNew(const osMutexAttr_t *attr) {
+    (void)attr;
+    return &mutexDummy;
+}
+
+osStatus_t osMutexAcquire(osMutexId_t mutex, uint32_t timeout) {
+    (void)mutex;
+    (void)timeout;
+    return osOK;
+}
+
+osStatus_t osMutexRelease(osMutexId_t mutex) {
+    (void)mutex;
+    return osOK;
+}
+
+uint32_t osKernelGetTickCount(void) {
+    return HAL_GetTick();
+}
+
+int32_t osKernelLock(void) {
+    return 0;
+}
+
+int32_t osKernelUnlock(void) {
+    return 0;
+}
+
+osStatus_t osDelay(uint32_t ticks) {
+    HAL_Delay(ticks);
+    sim_uartService();
+    return osOK;
+}
+
+osStatus_t osDelayUntil(uint32_t ticks) {
+    sleepUntilUs((uint64_t)ticks * 1000U);
+    return osOK;
+}
+
+// ─── Phía simulator ──────────────────────────────────────────────────────────
+void sim_halInit(int fd) {
+    uartFd = fd;
+    htim2.hdma[TIM_DMA_ID_CC1] = &hdmaTim2Ch1;
+
+    huart2.Instance = USART2;
+    huart2.hdmarx = &hdmaUsart2Rx;
+    huart2.Init.BaudRate = 115200;
+    huart2.Init.WordLength = UART_WORDLENGTH_8B;
+    huart2.Init.StopBits = UART_STOPBITS_1;
+    huart2.Init.Parity = UART_PARITY_NONE;
+    huart2.Init.Mode = UART_MODE_TX_RX;
+    huart2.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    huart2.Init.OverSampling = UART_OVERSAMPLING_16;
+    HAL_UART_Init(&huart2);
+
+    // TIM4 đếm 1 µs/tick (PSC = 71) như MX_TIM4_Init
+    htim4.Init.Prescaler = 71;
+    htim4.Instance->PSC = 71;
+
+    // TIM2 đếm 72 MHz (PSC = 0) cho timestamp encoder/auto-baud, TIM1/2/3 ARR = 65535 như MX_TIMx_Init
+    htim2.Init.Prescaler = 0;
+    htim2.Instance->PSC = 0;
+    htim1.Instance->ARR = 65535;
+    htim2.Instance->ARR = 65535;
+    htim3.Instance->ARR = 65535;
+}
+
+void sim_setThread(uint8_t thread) {
+    currentThread = thread;
+}
+
+uint32_t sim_threadFlags(uint8_t thread) {
+    return threadFlags[thread];
+}
+
+// Đưa CNT của TIM3 tới thời điểm hiện tại. Nếu counter đi qua CCR4 (CC4 interrupt
+// đang bật) thì dừng đúng ở mốc đó, bật cờ CC4 và trả về 1 - sim_drive gọi ngắt
+// rồi gọi lại cho tới khi trả về 0 (bắt kịp nếu host bị trễ nhiều bước compare)
+uint8_t sim_tim3Compare(void) {
+    uint64_t now = sim_nowUs() * (SystemCoreClock / 1000000U) / (sim_tim3.PSC + 1);
+    if ((sim_tim3.CR1 & TIM_CR1_CEN) == 0) {
+        tim3Ticks = now;
+        return 0;
+    }
+    if (sim_tim3.DIER & TIM_IT_CC4) {
+        uint32_t toMatch = (sim_tim3.CCR4 - (uint32_t)tim3Ticks) & 0xFFFF;
+        if (toMatch == 0) {
+            toMatch = 0x10000;
+        }
+        if (tim3Ticks + toMatch <= now) {
+            tim3Ticks += toMatch;
+            sim_tim3.CNT = tim3Ticks & 0xFFFF;
+            sim_tim3.SR |= TIM_FLAG_CC4;
+            return 1;
+        }
+    }
+    tim3Ticks = now;
+    sim_tim3.CNT = now & 0xFFFF;
+    return 0;
+}
+
+// µs tới mốc CC4 kế tiếp (0 = CC4 interrupt tắt)
+uint32_t sim_tim3CompareUs(void) {
+    if ((sim_tim3.CR1 & TIM_CR1_CEN) == 0 || (sim_tim3.DIER & TIM_IT_CC4) == 0) {
+        return 0;
+    }
+    uint32_t toMatch = (sim_tim3.CCR4 - sim_tim3.CNT) & 0xFFFF;
+    uint32_t ticksPerUs = SystemCoreClock / 1000000U / (sim_tim3.PSC + 1);
+    return toMatch / ticksPerUs + 1;
+}
+
+void sim_motorSetLoad(uint8_t percent) {
+    motorLoadPercent = percent;
+}
+
+static uint64_t tim2TicksAt(double timeUs) {
+    return (uint64_t)(timeUs * (SystemCoreClock / 1000000U) / (sim_tim2.PSC + 1));
+}
+
+// Giá trị capture của TIM2 (đếm xuống từ ARR) tại thời điểm timeUs
+static uint16_t tim2CountAt(double timeUs) {
+    return (uint16_t)(0xFFFFU - (tim2TicksAt(timeUs) & 0xFFFFU));
+}
+
+// Ngắt TIM2 ở mỗi nửa vòng counter tới timeUs: update (CNT về ARR) và CC3 (CNT = 0x8000)
+static void tim2InterruptsUntil(double timeUs) {
+    static uint64_t lastHalf = 0;
+    uint64_t half = tim2TicksAt(timeUs) >> 15;
+    if (lastHalf == 0 || half < lastHalf) {
+        lastHalf = half;
+        return;
+    }
+    while (lastHalf < half) {
+        lastHalf++;
+        uint32_t flag = (lastHalf & 1U) ? TIM_FLAG_CC3 : TIM_FLAG_UPDATE;
+        if (sim_tim2.DIER & flag) {
+            sim_tim2.SR |= flag;
+            sim_tim2.CNT = (uint16_t)(0xFFFFU - ((lastHalf << 15) & 0xFFFFU));
+            Encoder_HandleTimerInterrupt();
+        }
+    }
+}
+
+// Cạnh xuống encoder: DMA ghi CCR1 vào buffer rồi giảm CNDTR (circular)
+static void captureEdge(double timeUs) {
+    uint16_t capture = tim2CountAt(timeUs);
+    sim_tim2.CCR1 = capture;
+    if (captureBuffer == NULL || captureLength == 0) {
+        return;
+    }
+    uint32_t remaining = dmaTim2Ch1.CNDTR;
+    captureBuffer[captureLength - remaining] = capture;
+    dmaTim2Ch1.CNDTR = (remaining > 1) ? remaining - 1 : captureLength;
+}
+
+// Chạy mô hình Motor 1 tới hiện tại theo bước SIM_MOTOR_STEP_US; thời điểm cạnh nội
+// suy trong bước nên capture chính xác tới tick TIM2
+void sim_encoderService(void) {
+    uint64_t now = sim_nowUs();
+    if (motorLastUs == 0) {
+        motorLastUs = now;
+        return;
+    }
+    double duty = 0.0;
+    if ((sim_tim3.CCER & TIM_CCER_CC1E) && sim_tim3.ARR != 0) {
+        duty = 100.0 * sim_tim3.CCR1 / (sim_tim3.ARR + 1);
+    }
+    double targetRpm = (duty > motorLoadPercent) ? (duty - motorLoadPercent) * SIM_MOTOR_RPM_PER_PERCENT : 0.0;
+
+    while (motorLastUs < now) {
+        uint64_t stepUs = (now - motorLastUs < SIM_MOTOR_STEP_US) ? now - motorLastUs : SIM_MOTOR_STEP_US;
+        motorRpm += (targetRpm - motorRpm) * stepUs / SIM_MOTOR_TAU_US;
+        double start = encoderPosition;
+        encoderPosition += motorRpm / 60.0 * SIM_ENCODER_PPR * stepUs / 1000000.0;
+        for (double edge = (double)((uint64_t)start + 1); edge <= encoderPosition; edge += 1.0) {
+            double edgeUs = motorLastUs + (edge - start) / (encoderPosition - start) * stepUs;
+            tim2InterruptsUntil(edgeUs);
+            captureEdge(edgeUs);
+        }
+        motorLastUs += stepUs;
+        tim2InterruptsUntil((double)motorLastUs);
+    }
+    sim_tim2.CNT = tim2CountAt((double)now);
+}
+
+double sim_motorRpm(void) {
+    return motorRpm;
+}
+
+// Ghi byte nhận được vào buffer DMA vòng như DMA channel 6 thật
+uint16_t sim_uartFeed(const uint8_t *data, uint16_t length) {
+    if (huart2.RxState != HAL_UART_STATE_BUSY_RX || huart2.RxXferSize == 0) {
+        return 0;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t pos = huart2.RxXferSize - huart2.hdmarx->Instance->CNDTR;
+        huart2.pRxBuffPtr[pos] = data[i];
+        if (--huart2.hdmarx->Instance->CNDTR == 0) {
+            huart2.hdmarx->Instance->CNDTR = huart2.RxXferSize;
+        }
+    }
+    return length;
+}
+
+// Đường RX im lặng: IDLE (1 ký tự) rồi TIM4 CC1 (T1.5) và UPDATE (T3.5)
+void sim_uartLineIdle(void) {
+    huart2.Instance->SR |= UART_FLAG_IDLE;
+    handleUARTIdleInterrupt();
+    if (htim4.Instance->CR1 & TIM_CR1_CEN) {
+        htim4.Instance->SR |= TIM_FLAG_CC1 | TIM_FLAG_UPDATE;
+        htim4.Instance->CR1 &= ~TIM_CR1_CEN;
+        handleModbusTimerInterrupt();
+    }
+}
+
+// Thời gian (µs) từ lúc byte cuối tới đến khi firmware thấy frame: 1 ký tự + T3.5
+uint32_t sim_uartFrameGapUs(void) {
+    uint32_t charUs = (11UL * 1000000UL + huart2.Init.BaudRate - 1) / huart2.Init.BaudRate;
+    return charUs + (charUs * 7 + 1) / 2;
+}
+
+// Chạy ngắt TC (và ngắt TIM4 hết post guard) nếu đã tới hạn; trả về số µs còn lại (0 = không có TX)
+uint32_t sim_uartService(void) {
+    uint64_t now = sim_nowUs();
+    if (postGuardAtUs != 0) {
+        if (now < postGuardAtUs) {
+            return (uint32_t)(postGuardAtUs - now);
+        }
+        postGuardAtUs = 0;
+        if (htim4.Instance->CR1 & TIM_CR1_CEN) {
+            htim4.Instance->SR |= TIM_FLAG_UPDATE;
+            htim4.Instance->CR1 &= ~TIM_CR1_CEN;
+            handleModbusTimerInterrupt();
+        }
+        return 0;
+    }
+    if (txDoneAtUs == 0) {
+        return 0;
+    }
+    if (now < txDoneAtUs) {
+        return (uint32_t)(txDoneAtUs - now);
+    }
+    txDoneAtUs = 0;
+    if (write(uartFd, txWire, txWireLength) == (ssize_t)txWireLength) {
+        txByteCount += txWireLength;
+    }
+    huart2.gState = HAL_UART_STATE_READY;
+    HAL_UART_TxCpltCallback(&huart2);
+    // Post guard: TIM4 one-pulse vừa được bật trong ngắt TC
+    if (htim4.Instance->CR1 & TIM_CR1_CEN) {
+        postGuardAtUs = now + htim4.Instance->ARR + 1U;
+        return (uint32_t)(htim4.Instance->ARR + 1U);
+    }
+    return 0;
+}
+
+uint32_t sim_uartTxBytes(void) {
+    return txByteCount;
+}
+
+void Error_Handler(void) {
+    fprintf(stderr, "Error_Handler\n");
+    exit(1);
+}
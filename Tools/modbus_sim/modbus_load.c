@@ -0,0 +1,449 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST LOAD GENERATOR: Modbus RTU master đo throughput / latency
+// ═══════════════════════════════════════════════════════════════════════════════
+// Build & run (Linux, từ thư mục gốc project):
+//   gcc -O2 -ICore/Inc Tools/modbus_sim/modbus_load.c Core/Src/ModbusCRC.c -o modbus_load
+//   ./modbus_load /dev/pts/N                      // 10 s, mix mặc định, back-to-back
+//   ./modbus_load -r 200 -t 30 -m 3:50,16:50 /tmp/drive
+//   ./modbus_load -b 115200 /dev/ttyUSB0          // dùng được với drive thật qua USB-RS485
+//
+// Tùy chọn:
+//   -s addr       Slave address (mặc định 3 = DEFAULT_DEVICE_ID)
+//   -b baud       Baud của cổng serial (pty bỏ qua)
+//   -r rate       Transaction/s; 0 = gửi request mới ngay khi nhận response
+//   -t sec        Thời gian chạy
+//   -T ms         Response timeout
+//   -m mix        Trọng số FC, vd 3:70,6:15,16:15
+//   -R addr:qty   Vùng FC3 (mặc định 0x0000:16)
+//   -W addr:qty   Vùng FC6/FC16 (mặc định 0x0017:3 = PID Motor 2). Giá trị được đọc
+//                 trước bằng FC3 và ghi lại y nguyên, nên test không đổi cấu hình drive
+//
+// Latency = từ lúc gửi byte đầu request tới khi nhận đủ response (gồm cả thời gian
+// trên dây 2 chiều). Báo cáo: transaction/s, p50/p90/p99/max tổng và theo FC,
+// số CRC error, exception, timeout.
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define _GNU_SOURCE
+#include "ModbusCRC.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_FRAME_SIZE      256
+#define FC_KIND_COUNT       3
+
+typedef struct {
+    uint8_t funcCode;
+    unsigned weight;
+    uint32_t sent;
+    uint32_t ok;
+    uint32_t exceptions;
+    uint32_t crcErrors;
+    uint32_t timeouts;
+    uint32_t *latencyUs;
+    uint32_t latencyCount;
+    uint32_t latencyCap;
+} FcStats_t;
+
+static FcStats_t fcStats[FC_KIND_COUNT] = {
+    { .funcCode = 0x03, .weight = 70 },
+    { .funcCode = 0x06, .weight = 15 },
+    { .funcCode = 0x10, .weight = 15 },
+};
+
+static int fd = -1;
+static uint8_t slaveAddr = 3;
+static unsigned timeoutMs = 100;
+static uint16_t readAddr = 0x0000, readQty = 16;
+static uint16_t writeAddr = 0x0017, writeQty = 3;
+static uint16_t writeValues[123];
+
+static uint64_t nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void sleepUntilUs(uint64_t targetUs) {
+    uint64_t now = nowUs();
+    if (targetUs > now) {
+        struct timespec ts = {
+            .tv_sec = (targetUs - now) / 1000000ULL,
+            .tv_nsec = ((targetUs - now) % 1000000ULL) * 1000
+        };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static speed_t baudToSpeed(unsigned baud) {
+    switch (baud) {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return 0;
+    }
+}
+
+static int openPort(const char *path, unsigned baud) {
+    int port = open(path, O_RDWR | O_NOCTTY);
+    if (port < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(port, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        if (baudToSpeed(baud) != 0) {
+            cfsetspeed(&tio, baudToSpeed(baud));
+        }
+        tcsetattr(port, TCSANOW, &tio);
+    }
+    tcflush(port, TCIOFLUSH);
+    return port;
+}
+
+static uint16_t appendCRC(uint8_t *frame, uint16_t length) {
+    uint16_t crc = calcCRC(frame, length);
+    frame[length] = crc & 0xFF;
+    frame[length + 1] = crc >> 8;
+    return length + 2;
+}
+
+static uint16_t buildRequest(uint8_t funcCode, uint8_t *frame, uint16_t *expected) {
+    uint16_t length = 0;
+
+    frame[length++] = slaveAddr;
+    frame[length++] = funcCode;
+    switch (funcCode) {
+    case 0x03:
+        frame[length++] = readAddr >> 8;
+        frame[length++] = readAddr & 0xFF;
+        frame[length++] = readQty >> 8;
+        frame[length++] = readQty & 0xFF;
+        *expected = 5 + readQty * 2;
+        break;
+    case 0x06:
+        frame[length++] = writeAddr >> 8;
+        frame[length++] = writeAddr & 0xFF;
+        frame[length++] = writeValues[0] >> 8;
+        frame[length++] = writeValues[0] & 0xFF;
+        *expected = 8;
+        break;
+    default:
+        frame[length++] = writeAddr >> 8;
+        frame[length++] = writeAddr & 0xFF;
+        frame[length++] = writeQty >> 8;
+        frame[length++] = writeQty & 0xFF;
+        frame[length++] = writeQty * 2;
+        for (uint16_t i = 0; i < writeQty; i++) {
+            frame[length++] = writeValues[i] >> 8;
+            frame[length++] = writeValues[i] & 0xFF;
+        }
+        *expected = 8;
+        break;
+    }
+    return appendCRC(frame, length);
+}
+
+typedef enum {
+    RESULT_OK,
+    RESULT_EXCEPTION,
+    RESULT_CRC_ERROR,
+    RESULT_TIMEOUT
+} Result_t;
+
+// Đọc response: đủ `expected` byte, hoặc 5 byte nếu là exception (FC | 0x80)
+static Result_t readResponse(uint8_t funcCode, uint8_t *frame, uint16_t expected, uint16_t *received) {
+    uint64_t deadline = nowUs() + timeoutMs * 1000ULL;
+    uint16_t length = 0;
+
+    while (length < expected) {
+        if (length >= 2 && frame[1] == (funcCode | 0x80)) {
+            expected = 5;
+            if (length >= expected) {
+                break;
+            }
+        }
+        uint64_t now = nowUs();
+        if (now >= deadline) {
+            *received = length;
+            return RESULT_TIMEOUT;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        struct timespec wait = {
+            .tv_sec = (deadline - now) / 1000000ULL,
+            .tv_nsec = ((deadline - now) % 1000000ULL) * 1000
+        };
+        if (ppoll(&pfd, 1, &wait, NULL) > 0) {
+            ssize_t n = read(fd, frame + length, MAX_FRAME_SIZE - length);
+            if (n > 0) {
+                length += n;
+            }
+        }
+    }
+    *received = length;
+
+    if (calcCRC(frame, expected) != MODBUS_CRC_RESIDUE || frame[0] != slaveAddr) {
+        return RESULT_CRC_ERROR;
+    }
+    if (frame[1] == (funcCode | 0x80)) {
+        return RESULT_EXCEPTION;
+    }
+    return RESULT_OK;
+}
+
+// Sau lỗi: chờ bus im lặng rồi bỏ mọi byte còn sót để transaction sau bắt đầu sạch
+static void resync(void) {
+    usleep(5000);
+    tcflush(fd, TCIFLUSH);
+}
+
+static Result_t transact(uint8_t funcCode, uint32_t *latencyUs, uint8_t *response) {
+    uint8_t request[MAX_FRAME_SIZE];
+    uint16_t expected = 0;
+    uint16_t received = 0;
+    uint16_t length = buildRequest(funcCode, request, &expected);
+
+    uint64_t start = nowUs();
+    if (write(fd, request, length) != length) {
+        perror("write");
+        return RESULT_TIMEOUT;
+    }
+    Result_t result = readResponse(funcCode, response, expected, &received);
+    *latencyUs = (uint32_t)(nowUs() - start);
+    if (result == RESULT_TIMEOUT || result == RESULT_CRC_ERROR) {
+        resync();
+    }
+    return result;
+}
+
+static void addLatency(FcStats_t *s, uint32_t us) {
+    if (s->latencyCount == s->latencyCap) {
+        s->latencyCap = s->latencyCap ? s->latencyCap * 2 : 4096;
+        s->latencyUs = realloc(s->latencyUs, s->latencyCap * sizeof(uint32_t));
+        if (s->latencyUs == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    s->latencyUs[s->latencyCount++] = us;
+}
+
+static int compareU32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t count, unsigned pct) {
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t index = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+    return sorted[(index == 0) ? 0 : index - 1];
+}
+
+static void printRow(const char *name, uint32_t sent, uint32_t ok, uint32_t exc, uint32_t crc,
+                     uint32_t timeout, uint32_t *lat, uint32_t count) {
+    qsort(lat, count, sizeof(uint32_t), compareU32);
+    printf("%-6s %8u %8u %6u %6u %6u %8u %8u %8u %8u\n", name, sent, ok, exc, crc, timeout,
+           percentile(lat, count, 50), percentile(lat, count, 90), percentile(lat, count, 99),
+           count ? lat[count - 1] : 0);
+}
+
+static int parseRange(const char *arg, uint16_t *addr, uint16_t *qty) {
+    char *end;
+    unsigned long a = strtoul(arg, &end, 0);
+    if (*end != ':') {
+        return -1;
+    }
+    unsigned long q = strtoul(end + 1, &end, 0);
+    if (*end != '\0' || a > 0xFFFF || q == 0 || q > 123) {
+        return -1;
+    }
+    *addr = (uint16_t)a;
+    *qty = (uint16_t)q;
+    return 0;
+}
+
+static int parseMix(const char *arg) {
+    for (int i = 0; i < FC_KIND_COUNT; i++) {
+        fcStats[i].weight = 0;
+    }
+    char *copy = strdup(arg);
+    for (char *tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        unsigned fc, weight;
+        if (sscanf(tok, "%u:%u", &fc, &weight) != 2) {
+            free(copy);
+            return -1;
+        }
+        int found = 0;
+        for (int i = 0; i < FC_KIND_COUNT; i++) {
+            if (fcStats[i].funcCode == fc) {
+                fcStats[i].weight = weight;
+                found = 1;
+            }
+        }
+        if (!found) {
+            free(copy);
+            return -1;
+        }
+    }
+    free(copy);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s addr] [-b baud] [-r rate] [-t sec] [-T ms] [-m 3:70,6:15,16:15]\n"
+                    "          [-R addr:qty] [-W addr:qty] device\n", prog);
+}
+
+int main(int argc, char **argv) {
+    unsigned baud = 115200;
+    unsigned rate = 0;
+    unsigned durationSec = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:r:t:T:m:R:W:")) != -1) {
+        int bad = 0;
+        switch (opt) {
+        case 's': slaveAddr = (uint8_t)strtoul(optarg, NULL, 0); break;
+        case 'b': baud = strtoul(optarg, NULL, 0); break;
+        case 'r': rate = strtoul(optarg, NULL, 0); break;
+        case 't': durationSec = strtoul(optarg, NULL, 0); break;
+        case 'T': timeoutMs = strtoul(optarg, NULL, 0); break;
+        case 'm': bad = parseMix(optarg); break;
+        case 'R': bad = parseRange(optarg, &readAddr, &readQty); break;
+        case 'W': bad = parseRange(optarg, &writeAddr, &writeQty); break;
+        default:  bad = 1; break;
+        }
+        if (bad) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    unsigned totalWeight = 0;
+    for (int i = 0; i < FC_KIND_COUNT; i++) {
+        totalWeight += fcStats[i].weight;
+    }
+    if (totalWeight == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    fd = openPort(argv[optind], baud);
+    if (fd < 0) {
+        return 1;
+    }
+
+    // Đọc giá trị hiện tại của vùng ghi để FC6/FC16 ghi lại y nguyên
+    uint8_t response[MAX_FRAME_SIZE];
+    uint16_t savedAddr = readAddr, savedQty = readQty;
+    uint32_t latencyUs;
+    readAddr = writeAddr;
+    readQty = writeQty;
+    Result_t result = transact(0x03, &latencyUs, response);
+    readAddr = savedAddr;
+    readQty = savedQty;
+    if (result != RESULT_OK) {
+        fprintf(stderr, "Không đọc được vùng ghi 0x%04X:%u (%s)\n", writeAddr, writeQty,
+                result == RESULT_EXCEPTION ? "exception" : result == RESULT_CRC_ERROR ? "CRC" : "timeout");
+        return 1;
+    }
+    for (uint16_t i = 0; i < writeQty; i++) {
+        writeValues[i] = (uint16_t)(response[3 + i * 2] << 8) | response[4 + i * 2];
+    }
+
+    printf("Slave %u, FC3 0x%04X:%u, FC6/FC16 0x%04X:%u, %s, %u s\n", slaveAddr, readAddr, readQty,
+           writeAddr, writeQty, rate ? "paced" : "back-to-back", durationSec);
+    if (rate) {
+        printf("Target rate: %u transaction/s\n", rate);
+    }
+
+    srand(1);
+    uint64_t start = nowUs();
+    uint64_t end = start + durationSec * 1000000ULL;
+    uint64_t n = 0;
+
+    while (nowUs() < end) {
+        if (rate) {
+            sleepUntilUs(start + n * 1000000ULL / rate);
+        }
+        n++;
+
+        unsigned pick = (unsigned)rand() % totalWeight;
+        FcStats_t *s = &fcStats[0];
+        for (int i = 0; i < FC_KIND_COUNT; i++) {
+            if (pick < fcStats[i].weight) {
+                s = &fcStats[i];
+                break;
+            }
+            pick -= fcStats[i].weight;
+        }
+
+        s->sent++;
+        switch (transact(s->funcCode, &latencyUs, response)) {
+        case RESULT_OK:
+            s->ok++;
+            addLatency(s, latencyUs);
+            break;
+        case RESULT_EXCEPTION:
+            s->exceptions++;
+            addLatency(s, latencyUs);
+            break;
+        case RESULT_CRC_ERROR:
+            s->crcErrors++;
+            break;
+        case RESULT_TIMEOUT:
+            s->timeouts++;
+            break;
+        }
+    }
+    double elapsed = (nowUs() - start) / 1e6;
+
+    // Tổng hợp: gộp latency của mọi FC trước khi từng FC bị sort
+    FcStats_t all = { 0 };
+    for (int i = 0; i < FC_KIND_COUNT; i++) {
+        all.sent += fcStats[i].sent;
+        all.ok += fcStats[i].ok;
+        all.exceptions += fcStats[i].exceptions;
+        all.crcErrors += fcStats[i].crcErrors;
+        all.timeouts += fcStats[i].timeouts;
+        for (uint32_t j = 0; j < fcStats[i].latencyCount; j++) {
+            addLatency(&all, fcStats[i].latencyUs[j]);
+        }
+    }
+
+    printf("\n%-6s %8s %8s %6s %6s %6s %8s %8s %8s %8s\n", "FC", "sent", "ok", "exc", "crc", "tmo",
+           "p50 us", "p90 us", "p99 us", "max us");
+    for (int i = 0; i < FC_KIND_COUNT; i++) {
+        FcStats_t *s = &fcStats[i];
+        if (s->sent == 0) {
+            continue;
+        }
+        char name[8];
+        snprintf(name, sizeof(name), "%u", s->funcCode);
+        printRow(name, s->sent, s->ok, s->exceptions, s->crcErrors, s->timeouts, s->latencyUs, s->latencyCount);
+    }
+    printRow("all", all.sent, all.ok, all.exceptions, all.crcErrors, all.timeouts, all.latencyUs, all.latencyCount);
+    printf("\nThroughput: %.1f transaction/s (%.1f ok/s) trong %.2f s\n", all.sent / elapsed, all.ok / elapsed, elapsed);
+
+    close(fd);
+    return (all.crcErrors || all.timeouts) ? 2 : 0;
+}
@@ -0,0 +1,31 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+// Giao diện giữa hal_stubs.c và vòng lặp sự kiện sim_drive.c
+
+// "Thread" đang chạy - mỗi cái có thread flag riêng như task FreeRTOS
+#define SIM_THREAD_UART     0
+#define SIM_THREAD_MOTOR    1
+#define SIM_THREAD_OTHER    2
+#define SIM_THREAD_COUNT    3
+
+uint64_t sim_nowUs(void);
+int sim_openPty(const char *linkPath);
+void sim_closePty(int fd, const char *linkPath);
+void sim_halInit(int fd);
+uint16_t sim_uartFeed(const uint8_t *data, uint16_t length);
+void sim_uartLineIdle(void);
+uint32_t sim_uartFrameGapUs(void);
+uint32_t sim_uartService(void);
+uint32_t sim_uartTxBytes(void);
+void sim_setThread(uint8_t thread);
+uint32_t sim_threadFlags(uint8_t thread);
+uint8_t sim_tim3Compare(void);
+uint32_t sim_tim3CompareUs(void);
+void sim_motorSetLoad(uint8_t percent);
+void sim_encoderService(void);
+double sim_motorRpm(void);
+
+#endif
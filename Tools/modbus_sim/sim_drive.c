@@ -0,0 +1,245 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST SIMULATOR: drive DC chạy firmware Modbus thật trên pseudo-terminal
+// ═══════════════════════════════════════════════════════════════════════════════
+// Build (Linux, từ thư mục gốc project):
+//   gcc -O2 -ITools/modbus_sim/stubs -ICore/Inc -ITools/modbus_sim -o sim_drive
+//       Tools/modbus_sim/{sim_drive,sim_pty,hal_stubs}.c
+//       Core/Src/{UartModbus,MotorControl,MotionProfile,Encoder,DOutput,ModbusCRC,ModbusLatency,Telemetry}.c -lm
+//   ./sim_drive                  // in đường dẫn /dev/pts/N cho master
+//   ./sim_drive -l /tmp/drive    // thêm symlink cố định tới pty
+//   ./sim_drive -L 20            // tải Motor 1 = 20% duty
+//
+// - Các task của main.c (Uart/Motor/Encoder/IO) chạy tuần tự trong 1 vòng poll();
+//   MotorTask chạy mỗi khi mốc CC4 của TIM3 đánh thức nó (Control_Rate_Hz, 0x0124)
+//   Jitter/overrun ở 0x0126/0x0127 phần lớn là do host ngủ quá giờ và UartTask chờ TX
+//   không bị MotorTask chen vào như trên drive thật - chỉ dùng để kiểm tra đường đi
+// - Frame kết thúc khi pty im lặng 1 ký tự + T3.5 ở baud hiện tại; response ra pty
+//   sau đúng thời gian truyền 11 bit/ký tự. Riêng thời gian truyền request không
+//   mô phỏng (pty giao cả frame ngay) nên latency thấp hơn drive thật đúng khoảng đó
+// - Motor 1 là mô hình quán tính 150 RPM ở 100% duty, encoder 8 xung/vòng vào DMA
+//   TIM2_CH1; -L <%> thêm tải (trừ vào duty) để kiểm tra PID tốc độ bù sụt tốc.
+//   Motor 2 không có encoder, GPIO/PWM còn lại chỉ là biến trong RAM
+// - Ctrl+C: in bộ đếm comm diagnostics rồi thoát
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define _GNU_SOURCE
+// Không include <stdlib.h>: MotorControl.h có biến toàn cục tên system
+#include "sim.h"
+#include "main.h"
+#include "UartModbus.h"
+#include "ModbusMap.h"
+#include "MotorControl.h"
+#include "Encoder.h"
+#include "DOutput.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define ENCODER_PERIOD_MS   10
+#define IO_PERIOD_MS        500
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+// Thân vòng lặp của StartUartTask
+static void runUartTask(void) {
+    g_modbusCounter++;
+    processAutoBaud();
+    if (frameReceived) {
+        processModbusFrame();
+    }
+    updateSerialConfig();
+    updateCommDiagnostics();
+    checkUARTHealth();
+}
+
+// Thân vòng lặp của StartMotorTask, sau ControlLoop_WaitTick
+static void runMotorTask(void) {
+    const uint16_t M1_BASE_ADDR = 0x0000;
+    const uint16_t M2_BASE_ADDR = 0x0010;
+    const uint16_t SYS_BASE_ADDR = 0x0100;
+
+    Encoder_UpdateSpeed();
+    if (consumeDirtyRegisters(M1_BASE_ADDR, MOTOR_REG_BLOCK_COUNT)) {
+        MotorRegisters_Load(&motor1, M1_BASE_ADDR);
+    }
+    if (consumeDirtyRegisters(M2_BASE_ADDR, MOTOR_REG_BLOCK_COUNT)) {
+        MotorRegisters_Load(&motor2, M2_BASE_ADDR);
+    }
+    if (consumeDirtyRegisters(SYS_BASE_ADDR, SYSTEM_REG_BLOCK_COUNT)) {
+        SystemRegisters_Load(&system);
+    }
+    if (system.Reset_Error_Command == 1) {
+        System_ResetSystem();
+    }
+    Motor_ProcessControl(&motor1);
+    Motor_ProcessControl(&motor2);
+    MotorRegisters_Save(&motor1, M1_BASE_ADDR);
+    MotorRegisters_Save(&motor2, M2_BASE_ADDR);
+    SystemRegisters_Save(&system);
+    publishProcessImage();
+}
+
+// Thân vòng lặp của StartEncoderTask
+static void runEncoderTask(void) {
+    if (consumeDirtyRegisters(REG_ENCODER_STATUS_WORD, ENCODER_REG_BLOCK_COUNT)) {
+        Encoder_Load(&encoder1);
+    }
+    Encoder_Process(&encoder1);
+    Encoder_Save(&encoder1);
+}
+
+// Thân vòng lặp của StartIOTask
+static void runIOTask(void) {
+    DOutput_Load(&doutput_state);
+    DOutput_Process(&doutput_state);
+    DOutput_Save(&doutput_state);
+    updateDigitalIOStatus();
+    g_taskCounter++;
+    g_inputRegisters[0] = g_taskCounter;
+    g_inputRegisters[1] = HAL_GetTick() & 0xFFFF;
+}
+
+static uint64_t minDeadline(uint64_t a, uint64_t b) {
+    return (a < b) ? a : b;
+}
+
+int main(int argc, char **argv) {
+    const char *linkPath = NULL;
+    unsigned int load = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:L:")) != -1) {
+        if (opt == 'l') {
+            linkPath = optarg;
+        } else if (opt == 'L' && sscanf(optarg, "%u", &load) == 1 && load <= 100) {
+            sim_motorSetLoad((uint8_t)load);
+        } else {
+            fprintf(stderr, "Usage: %s [-l symlink] [-L load%%]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    int fd = sim_openPty(linkPath);
+    if (fd < 0) {
+        return 1;
+    }
+    sim_halInit(fd);
+
+    // Thứ tự khởi tạo như main() + đầu các task
+    initializeModbusRegisters();
+    Encoder_Init();
+    const osMutexAttr_t modbusTxMutex_attributes = { .name = "modbusTxMutex" };
+    modbusTxMutex = osMutexNew(&modbusTxMutex_attributes);
+    startModbusUARTReception();
+    PID_Init(1, DEFAULT_PID_KP, DEFAULT_PID_KI, DEFAULT_PID_KD);
+    PID_Init(2, DEFAULT_PID_KP, DEFAULT_PID_KI, DEFAULT_PID_KD);
+    sim_tim3Compare();
+    sim_setThread(SIM_THREAD_MOTOR);
+    ControlLoop_Start();
+    sim_setThread(SIM_THREAD_UART);
+    updateCommDiagnostics();
+    printf("USART2 %lu baud, T1.5 = %u us, T3.5 = %u us, control loop %u Hz\n", (unsigned long)huart2.Init.BaudRate,
+           HREG(REG_COMM_T15_US), HREG(REG_COMM_T35_US), HREG(REG_CONTROL_RATE_HZ));
+    fflush(stdout);
+
+    uint64_t now = sim_nowUs();
+    uint64_t nextEncoderUs = now;
+    uint64_t nextIOUs = now;
+    uint64_t nextHealthUs = now + UART_HEALTH_CHECK_INTERVAL * 1000ULL;
+    uint64_t lastRxUs = 0;
+    uint8_t rxPending = 0;
+
+    while (running) {
+        now = sim_nowUs();
+        uint64_t deadline = minDeadline(nextEncoderUs, minDeadline(nextIOUs, nextHealthUs));
+        uint32_t compareUs = sim_tim3CompareUs();
+        if (compareUs != 0) {
+            deadline = minDeadline(deadline, now + compareUs);
+        }
+        if (rxPending) {
+            deadline = minDeadline(deadline, lastRxUs + sim_uartFrameGapUs());
+        }
+        uint32_t txRemainUs = sim_uartService();
+        if (txRemainUs != 0) {
+            deadline = minDeadline(deadline, now + txRemainUs);
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        struct timespec timeout = { 0, 0 };
+        if (deadline > now) {
+            timeout.tv_sec = (deadline - now) / 1000000ULL;
+            timeout.tv_nsec = ((deadline - now) % 1000000ULL) * 1000;
+        }
+        int ready = ppoll(&pfd, 1, &timeout, NULL);
+        if (ready < 0 && errno != EINTR) {
+            perror("ppoll");
+            break;
+        }
+        now = sim_nowUs();
+
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            uint8_t buf[256];
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) {
+                sim_uartFeed(buf, (uint16_t)n);
+                lastRxUs = now;
+                rxPending = 1;
+            }
+        }
+
+        // Ngắt IDLE + TIM4 -> frame vào rxBuffer, báo UartTask
+        if (rxPending && now - lastRxUs >= sim_uartFrameGapUs()) {
+            rxPending = 0;
+            sim_uartLineIdle();
+        }
+        sim_uartService();
+
+        // Xung encoder tới hiện tại vào DMA TIM2_CH1
+        sim_encoderService();
+
+        // Ngắt TIM3 CC4 -> MotorTask (Realtime) chạy trước UartTask
+        while (sim_tim3Compare()) {
+            handleControlTickInterrupt();
+        }
+        if (sim_threadFlags(SIM_THREAD_MOTOR) != 0) {
+            sim_setThread(SIM_THREAD_MOTOR);
+            ControlLoop_WaitTick();
+            runMotorTask();
+            sim_setThread(SIM_THREAD_UART);
+        }
+
+        if (osThreadFlagsWait(MODBUS_FLAG_FRAME_READY | MODBUS_FLAG_AUTOBAUD, osFlagsWaitAny, 0) != osFlagsErrorTimeout ||
+            now >= nextHealthUs) {
+            runUartTask();
+            nextHealthUs = sim_nowUs() + UART_HEALTH_CHECK_INTERVAL * 1000ULL;
+        }
+        if (now >= nextEncoderUs) {
+            runEncoderTask();
+            nextEncoderUs += ENCODER_PERIOD_MS * 1000ULL;
+        }
+        if (now >= nextIOUs) {
+            runIOTask();
+            nextIOUs += IO_PERIOD_MS * 1000ULL;
+        }
+    }
+
+    printf("\nFrames: %lu  CRC errors: %lu  Overruns: %lu  UART errors: %lu  T1.5 violations: %u  TX bytes: %lu\n",
+           (unsigned long)g_totalReceived, (unsigned long)g_corruptionCount, (unsigned long)g_overrunCount,
+           (unsigned long)g_uartErrorCount, HREG(REG_COMM_T15_VIOLATION_COUNT), (unsigned long)sim_uartTxBytes());
+    printf("Control loop: dt = %u us, jitter max = %u us, overruns: %u\n", HREG(REG_CONTROL_DT_US),
+           HREG(REG_CONTROL_JITTER_US), HREG(REG_CONTROL_OVERRUN_COUNT));
+    printf("Motor 1: model %.1f RPM, measured %.1f RPM\n", sim_motorRpm(), (int16_t)HREG(REG_SPEED_M1_RPM_X10) / 10.0);
+    sim_closePty(fd, linkPath);
+    return 0;
+}
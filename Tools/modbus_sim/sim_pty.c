@@ -0,0 +1,56 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST SIMULATOR: pseudo-terminal thay cho đường RS-485 của USART2
+// ═══════════════════════════════════════════════════════════════════════════════
+// Tách khỏi hal_stubs.c vì <termios.h> định nghĩa macro CR1, CR2... trùng tên
+// thanh ghi trong stub HAL.
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#define _GNU_SOURCE
+#include "sim.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+static int slaveFd = -1;
+
+int sim_openPty(const char *linkPath) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    const char *slaveName = ptsname(fd);
+
+    // Giữ slave mở để master không nhận EIO/HUP khi client đóng rồi mở lại,
+    // và tắt line discipline (0x0A không bị đổi thành 0x0D 0x0A)
+    slaveFd = open(slaveName, O_RDWR | O_NOCTTY);
+    if (slaveFd < 0) {
+        perror(slaveName);
+        close(fd);
+        return -1;
+    }
+    struct termios tio;
+    tcgetattr(slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd, TCSANOW, &tio);
+
+    if (linkPath != NULL) {
+        unlink(linkPath);
+        if (symlink(slaveName, linkPath) != 0) {
+            perror("symlink");
+        }
+    }
+    printf("Drive mô phỏng: %s%s%s\n", slaveName, linkPath ? " -> " : "", linkPath ? linkPath : "");
+    return fd;
+}
+
+void sim_closePty(int fd, const char *linkPath) {
+    if (linkPath != NULL) {
+        unlink(linkPath);
+    }
+    close(slaveFd);
+    close(fd);
+}
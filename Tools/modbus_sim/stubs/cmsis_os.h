@@ -0,0 +1,37 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST STUB: cmsis_os.h (CMSIS-RTOS2) cho Tools/modbus_sim
+// ═══════════════════════════════════════════════════════════════════════════════
+// Simulator chạy các "task" tuần tự trong 1 thread (sim_drive.c) nên mutex/kernel
+// lock không cần làm gì; thread flag chỉ được lưu lại để osThreadFlagsWait đọc.
+// ═══════════════════════════════════════════════════════════════════════════════
+#ifndef SIM_CMSIS_OS_H
+#define SIM_CMSIS_OS_H
+
+#include <stdint.h>
+
+typedef void *osThreadId_t;
+typedef void *osMutexId_t;
+typedef int32_t osStatus_t;
+
+typedef struct {
+    const char *name;
+} osMutexAttr_t;
+
+#define osOK                    0
+#define osWaitForever           0xFFFFFFFFU
+#define osFlagsWaitAny          0x00000000U
+#define osFlagsErrorTimeout     0xFFFFFFFEU
+
+osThreadId_t osThreadGetId(void);
+uint32_t osThreadFlagsSet(osThreadId_t thread, uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+osMutexId_t osMutexNew(const osMutexAttr_t *attr);
+osStatus_t osMutexAcquire(osMutexId_t mutex, uint32_t timeout);
+osStatus_t osMutexRelease(osMutexId_t mutex);
+uint32_t osKernelGetTickCount(void);
+int32_t osKernelLock(void);
+int32_t osKernelUnlock(void);
+osStatus_t osDelay(uint32_t ticks);
+osStatus_t osDelayUntil(uint32_t ticks);
+
+#endif
@@ -0,0 +1,301 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST STUB: stm32f1xx_hal.h cho Tools/modbus_sim
+// ═══════════════════════════════════════════════════════════════════════════════
+// Chỉ khai báo phần HAL/CMSIS mà UartModbus.c, MotorControl.c, Encoder.c (và các
+// module chúng gọi tới) dùng. Thanh ghi ngoại vi là struct thường trong RAM host,
+// hành vi (DMA RX, TX, ngắt) do hal_stubs.c mô phỏng.
+// ═══════════════════════════════════════════════════════════════════════════════
+#ifndef SIM_STM32F1XX_HAL_H
+#define SIM_STM32F1XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO volatile
+#define __weak __attribute__((weak))
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    RESET = 0U,
+    SET = !RESET
+} FlagStatus, ITStatus;
+
+// ─── Core (PRIMASK, barrier, DWT) ────────────────────────────────────────────
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+void __enable_irq(void);
+#define __DMB()     __sync_synchronize()
+#define __DSB()     __sync_synchronize()
+#define __NOP()     ((void)0)
+
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+// CYCCNT chạy theo đồng hồ host quy về SystemCoreClock
+DWT_Type *sim_dwt(void);
+extern CoreDebug_Type sim_coreDebug;
+#define DWT                         (sim_dwt())
+#define CoreDebug                   (&sim_coreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+extern uint32_t SystemCoreClock;
+
+// ─── GPIO ────────────────────────────────────────────────────────────────────
+typedef struct {
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef sim_gpioA, sim_gpioB, sim_gpioC;
+#define GPIOA   (&sim_gpioA)
+#define GPIOB   (&sim_gpioB)
+#define GPIOC   (&sim_gpioC)
+
+#define GPIO_PIN_0      ((uint16_t)0x0001)
+#define GPIO_PIN_1      ((uint16_t)0x0002)
+#define GPIO_PIN_2      ((uint16_t)0x0004)
+#define GPIO_PIN_3      ((uint16_t)0x0008)
+#define GPIO_PIN_4      ((uint16_t)0x0010)
+#define GPIO_PIN_5      ((uint16_t)0x0020)
+#define GPIO_PIN_6      ((uint16_t)0x0040)
+#define GPIO_PIN_7      ((uint16_t)0x0080)
+#define GPIO_PIN_8      ((uint16_t)0x0100)
+#define GPIO_PIN_9      ((uint16_t)0x0200)
+#define GPIO_PIN_10     ((uint16_t)0x0400)
+#define GPIO_PIN_11     ((uint16_t)0x0800)
+#define GPIO_PIN_12     ((uint16_t)0x1000)
+#define GPIO_PIN_13     ((uint16_t)0x2000)
+#define GPIO_PIN_14     ((uint16_t)0x4000)
+#define GPIO_PIN_15     ((uint16_t)0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin);
+
+// ─── DMA ─────────────────────────────────────────────────────────────────────
+typedef struct {
+    __IO uint32_t CCR;
+    __IO uint32_t CNDTR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    DMA_Channel_TypeDef *Instance;
+} DMA_HandleTypeDef;
+
+#define DMA_IT_TC   0x00000002U
+#define DMA_IT_HT   0x00000004U
+
+#define __HAL_DMA_GET_COUNTER(h)        ((h)->Instance->CNDTR)
+#define __HAL_DMA_DISABLE_IT(h, it)     ((h)->Instance->CCR &= ~(it))
+
+// ─── TIM ─────────────────────────────────────────────────────────────────────
+typedef struct {
+    __IO uint32_t CR1;
+    __IO uint32_t DIER;
+    __IO uint32_t SR;
+    __IO uint32_t CCER;
+    __IO uint32_t CNT;
+    __IO uint32_t PSC;
+    __IO uint32_t ARR;
+    __IO uint32_t CCR1;
+    __IO uint32_t CCR2;
+    __IO uint32_t CCR3;
+    __IO uint32_t CCR4;
+} TIM_TypeDef;
+
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+typedef enum {
+    HAL_TIM_ACTIVE_CHANNEL_1 = 0x01U,
+    HAL_TIM_ACTIVE_CHANNEL_2 = 0x02U,
+    HAL_TIM_ACTIVE_CHANNEL_3 = 0x04U,
+    HAL_TIM_ACTIVE_CHANNEL_4 = 0x08U,
+    HAL_TIM_ACTIVE_CHANNEL_CLEARED = 0x00U
+} HAL_TIM_ActiveChannel;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+    HAL_TIM_ActiveChannel Channel;
+    DMA_HandleTypeDef *hdma[7];
+} TIM_HandleTypeDef;
+
+typedef struct {
+    uint32_t ICPolarity;
+    uint32_t ICSelection;
+    uint32_t ICPrescaler;
+    uint32_t ICFilter;
+} TIM_IC_InitTypeDef;
+
+extern TIM_TypeDef sim_tim1, sim_tim2, sim_tim3, sim_tim4;
+#define TIM1    (&sim_tim1)
+#define TIM2    (&sim_tim2)
+#define TIM3    (&sim_tim3)
+#define TIM4    (&sim_tim4)
+
+#define TIM_CHANNEL_1       0x00000000U
+#define TIM_CHANNEL_2       0x00000004U
+#define TIM_CHANNEL_3       0x00000008U
+#define TIM_CHANNEL_4       0x0000000CU
+
+#define TIM_FLAG_UPDATE     (1U << 0)
+#define TIM_FLAG_CC1        (1U << 1)
+#define TIM_FLAG_CC2        (1U << 2)
+#define TIM_FLAG_CC3        (1U << 3)
+#define TIM_FLAG_CC4        (1U << 4)
+#define TIM_IT_UPDATE       TIM_FLAG_UPDATE
+#define TIM_IT_CC1          TIM_FLAG_CC1
+#define TIM_IT_CC2          TIM_FLAG_CC2
+#define TIM_IT_CC3          TIM_FLAG_CC3
+#define TIM_IT_CC4          TIM_FLAG_CC4
+#define TIM_CR1_CEN         (1U << 0)
+#define TIM_CCER_CC1E       (1U << 0)
+#define TIM_CCER_CC4E       (1U << 12)
+#define TIM_CCER_CCxE_MASK  0x1111U
+
+#define TIM_DMA_ID_CC1                      ((uint16_t)0x0001)
+#define TIM_INPUTCHANNELPOLARITY_RISING     0x00000000U
+#define TIM_INPUTCHANNELPOLARITY_FALLING    0x00000002U
+#define TIM_ICSELECTION_DIRECTTI            0x00000001U
+#define TIM_ICPSC_DIV1                      0x00000000U
+
+#define __HAL_TIM_ENABLE(h)                 ((h)->Instance->CR1 |= TIM_CR1_CEN)
+#define __HAL_TIM_DISABLE(h)                ((h)->Instance->CR1 &= ~TIM_CR1_CEN)
+#define __HAL_TIM_ENABLE_IT(h, it)          ((h)->Instance->DIER |= (it))
+#define __HAL_TIM_DISABLE_IT(h, it)         ((h)->Instance->DIER &= ~(it))
+#define __HAL_TIM_GET_FLAG(h, f)            ((((h)->Instance->SR & (f)) == (f)) ? SET : RESET)
+#define __HAL_TIM_CLEAR_FLAG(h, f)          ((h)->Instance->SR = ~(f) & (h)->Instance->SR)
+#define __HAL_TIM_GET_IT_SOURCE(h, it)      ((((h)->Instance->DIER & (it)) == (it)) ? SET : RESET)
+#define __HAL_TIM_SET_COUNTER(h, v)         ((h)->Instance->CNT = (v))
+#define __HAL_TIM_GET_COUNTER(h)            ((h)->Instance->CNT)
+#define __HAL_TIM_SET_AUTORELOAD(h, v)      ((h)->Instance->ARR = (v))
+#define __HAL_TIM_GET_AUTORELOAD(h)         ((h)->Instance->ARR)
+#define __HAL_TIM_SET_COMPARE(h, ch, v)     (*(&(h)->Instance->CCR1 + ((ch) >> 2)) = (v))
+#define __HAL_TIM_GET_COMPARE(h, ch)        (*(&(h)->Instance->CCR1 + ((ch) >> 2)))
+#define HAL_TIM_ReadCapturedValue(h, ch)    __HAL_TIM_GET_COMPARE(h, ch)
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_IC_Start_IT(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_IC_Stop_IT(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_IC_Start_DMA(TIM_HandleTypeDef *htim, uint32_t channel, uint32_t *data, uint16_t length);
+HAL_StatusTypeDef HAL_TIM_IC_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_IC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_IC_InitTypeDef *config, uint32_t channel);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_IC_CaptureHalfCpltCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
+
+// ─── USART ───────────────────────────────────────────────────────────────────
+typedef struct {
+    __IO uint32_t SR;
+    __IO uint32_t DR;
+    __IO uint32_t BRR;
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t CR3;
+} USART_TypeDef;
+
+typedef struct {
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef enum {
+    HAL_UART_STATE_RESET = 0x00U,
+    HAL_UART_STATE_READY = 0x20U,
+    HAL_UART_STATE_BUSY = 0x24U,
+    HAL_UART_STATE_BUSY_TX = 0x21U,
+    HAL_UART_STATE_BUSY_RX = 0x22U
+} HAL_UART_StateTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    uint8_t *pRxBuffPtr;
+    uint16_t RxXferSize;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    __IO HAL_UART_StateTypeDef gState;
+    __IO HAL_UART_StateTypeDef RxState;
+    __IO uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+extern USART_TypeDef sim_usart2;
+#define USART2  (&sim_usart2)
+
+#define UART_WORDLENGTH_8B      0x00000000U
+#define UART_WORDLENGTH_9B      0x00001000U
+#define UART_STOPBITS_1         0x00000000U
+#define UART_STOPBITS_2         0x00002000U
+#define UART_PARITY_NONE        0x00000000U
+#define UART_PARITY_EVEN        0x00000400U
+#define UART_PARITY_ODD         0x00000600U
+#define UART_MODE_TX_RX         0x0000000CU
+#define UART_HWCONTROL_NONE     0x00000000U
+#define UART_OVERSAMPLING_16    0x00000000U
+
+#define UART_FLAG_IDLE          (1U << 4)
+#define UART_IT_IDLE            (1U << 4)
+
+#define HAL_UART_ERROR_NONE     0x00000000U
+#define HAL_UART_ERROR_PE       0x00000001U
+#define HAL_UART_ERROR_NE       0x00000002U
+#define HAL_UART_ERROR_FE       0x00000004U
+#define HAL_UART_ERROR_ORE      0x00000008U
+#define HAL_UART_ERROR_DMA      0x00000010U
+
+#define __HAL_UART_GET_FLAG(h, f)           ((((h)->Instance->SR & (f)) == (f)) ? SET : RESET)
+#define __HAL_UART_CLEAR_IDLEFLAG(h)        ((h)->Instance->SR &= ~UART_FLAG_IDLE)
+#define __HAL_UART_ENABLE_IT(h, it)         ((h)->Instance->CR1 |= (it))
+#define __HAL_UART_DISABLE_IT(h, it)        ((h)->Instance->CR1 &= ~(it))
+#define __HAL_UART_GET_IT_SOURCE(h, it)     ((((h)->Instance->CR1 & (it)) == (it)) ? SET : RESET)
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+// ─── I2C (chỉ để main.h biên dịch được) ──────────────────────────────────────
+typedef struct {
+    void *Instance;
+} I2C_HandleTypeDef;
+
+// ─── RCC / tick ──────────────────────────────────────────────────────────────
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+
+#endif
@@ -0,0 +1,288 @@
+// ═══════════════════════════════════════════════════════════════════════════════
+// HOST BENCHMARK: PID_Compute float cũ vs Q16.16 (MotorControl.c)
+// ═══════════════════════════════════════════════════════════════════════════════
+// Build & run (Linux, từ thư mục gốc project - MotorControl.c link với stub của simulator):
+//   gcc -O2 -ITools/modbus_sim/stubs -ICore/Inc -ITools/modbus_sim -o pid_bench
+//       Tools/pid_bench/pid_bench.c Tools/modbus_sim/hal_stubs.c
+//       Core/Src/{UartModbus,MotorControl,MotionProfile,Encoder,DOutput,ModbusCRC,ModbusLatency,Telemetry}.c -lm
+//   ./pid_bench            // hoặc ./pid_bench -f 3000 nếu /proc/cpuinfo không có MHz
+//
+// - Chạy 2 implementation song song trên cùng 1 plant bậc 1 (step 0 -> 60 -> 20 -> 45 %),
+//   kiểm tra output Q16 bám output float trong PID_BENCH_TOLERANCE %
+// - Đo ns/lần gọi và quy ra cycle ở xung nhịp host (-f MHz nếu không đọc được).
+//   PID_Compute Q16 có thêm 2 lần đọc DWT->CYCCNT (thanh ghi 0x0128) - trên host
+//   DWT là clock_gettime nên phần này được đo riêng và trừ ra
+// - Host có FPU nên float ở đây chỉ là vài lệnh SSE. Trên Cortex-M3 bản float gọi
+//   ~33 hàm soft-float mỗi lần (6 fdiv, 7 fmul, ~10 fadd/fsub, ~7 fcmp, 3 ui2f),
+//   bản Q16 không gọi hàm nào - số cycle thật trên target đọc ở PID_Cycles (0x0128)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+#include "MotorControl.h"
+#include "UartModbus.h"
+#include "ModbusMap.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MIN_NS            200000000ULL    // Mỗi implementation chạy tối thiểu 200 ms
+#define BENCH_STEPS             3000            // 3 s ở 1 kHz
+#define PID_BENCH_DT            0.001f          // controlDt mặc định (DEFAULT_CONTROL_RATE_HZ)
+#define PID_BENCH_TOLERANCE     0.5f            // % duty
+#define PID_BENCH_KP            80
+#define PID_BENCH_KI            150
+#define PID_BENCH_KD            2
+#define PID_BENCH_MAX_ACC       100
+
+// Implementation cũ (float) giữ nguyên từ MotorControl.c trước Q16.16 để so sánh
+typedef struct {
+    float integral;
+    float last_error;
+    float output;
+    float error;
+    float max_integral;
+    float acceleration_limit;
+    float max_output;
+    float setpoint;
+    float feedback;
+    float p_term;
+    float i_term;
+    float d_term;
+} FloatPIDState_t;
+
+#define PID_D_FILTER_TAU        0.09f
+
+static FloatPIDState_t float_state;
+static float controlDt = PID_BENCH_DT;
+
+static float PID_Compute_float(uint8_t motor_id, float setpoint, float feedback) {
+    MotorRegisterMap_t* motor = (motor_id == 1) ? &motor1 : &motor2;
+    FloatPIDState_t* pid_state = &float_state;
+
+    const float SAMPLE_TIME = controlDt;
+
+    pid_state->setpoint = setpoint;
+    pid_state->feedback = feedback;
+    pid_state->error = setpoint - feedback;
+
+    float kp = (float)motor->PID_Kp / 100.0f;
+    float ki = (float)motor->PID_Ki / 100.0f;
+    float kd = (float)motor->PID_Kd / 100.0f;
+
+    float p_term = kp * pid_state->error;
+
+    pid_state->integral += pid_state->error * SAMPLE_TIME;
+
+    float max_integral = (ki != 0) ? (pid_state->max_output / ki) : pid_state->max_integral;
+    if (pid_state->integral > max_integral) {
+        pid_state->integral = max_integral;
+    } else if (pid_state->integral < -max_integral) {
+        pid_state->integral = -max_integral;
+    }
+    float i_term = ki * pid_state->integral;
+
+    float derivative = (pid_state->error - pid_state->last_error) / SAMPLE_TIME;
+
+    static float filtered_derivative1 = 0;
+    static float filtered_derivative2 = 0;
+    float* filtered_d = (motor_id == 1) ? &filtered_derivative1 : &filtered_derivative2;
+
+    const float FILTER_ALPHA = SAMPLE_TIME / (PID_D_FILTER_TAU + SAMPLE_TIME);
+    *filtered_d = (FILTER_ALPHA * derivative) + ((1.0f - FILTER_ALPHA) * (*filtered_d));
+
+    float d_term = kd * (*filtered_d);
+    pid_state->last_error = pid_state->error;
+    pid_state->p_term = p_term;
+    pid_state->i_term = i_term;
+    pid_state->d_term = d_term;
+
+    float raw_output = p_term + i_term + d_term;
+
+    float max_rate_change = pid_state->acceleration_limit * SAMPLE_TIME;
+    float output_change = raw_output - pid_state->output;
+    if (output_change > max_rate_change) {
+        raw_output = pid_state->output + max_rate_change;
+    } else if (output_change < -max_rate_change) {
+        raw_output = pid_state->output - max_rate_change;
+    }
+
+    if (raw_output > pid_state->max_output) {
+        raw_output = pid_state->max_output;
+    } else if (raw_output < 0.0f) {
+        raw_output = 0.0f;
+    }
+
+    pid_state->output = raw_output;
+    return raw_output;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Ngăn compiler bỏ vòng lặp benchmark
+static volatile float sinkFloat;
+static volatile q16_t sinkQ16;
+static volatile uint32_t sinkCycles;
+
+static void resetStates(void) {
+    memset(&float_state, 0, sizeof(float_state));
+    float_state.max_integral = 1000.0f;
+    float_state.max_output = 100.0f;
+    float_state.acceleration_limit = (float)PID_BENCH_MAX_ACC;
+
+    PID_Init(1, PID_BENCH_KP, PID_BENCH_KI, PID_BENCH_KD);
+    pid_state1.acceleration_limit = q16FromInt(PID_BENCH_MAX_ACC);
+}
+
+static float setpointAt(int step) {
+    return (step < BENCH_STEPS / 3) ? 60.0f : (step < 2 * BENCH_STEPS / 3) ? 20.0f : 45.0f;
+}
+
+// Plant bậc 1: duty % -> tốc độ %, tau 50 ms
+static float plantStep(float speed, float duty) {
+    return speed + (duty - speed) * (PID_BENCH_DT / 0.05f);
+}
+
+static int verify(void) {
+    float speedFloat = 0.0f;
+    float speedQ16 = 0.0f;
+    float maxDiff = 0.0f;
+
+    resetStates();
+    for (int step = 0; step < BENCH_STEPS; step++) {
+        float outFloat = PID_Compute_float(1, setpointAt(step), speedFloat);
+        q16_t outQ16 = PID_Compute(1, q16FromInt((int32_t)setpointAt(step)),
+                                   (q16_t)(speedQ16 * Q16_ONE));
+        float diff = outFloat - (float)outQ16 / Q16_ONE;
+        if (diff < 0) {
+            diff = -diff;
+        }
+        if (diff > maxDiff) {
+            maxDiff = diff;
+        }
+        speedFloat = plantStep(speedFloat, outFloat);
+        speedQ16 = plantStep(speedQ16, (float)outQ16 / Q16_ONE);
+    }
+
+    printf("verify: %d steps, max |float - Q16| = %.4f %% duty (limit %.1f), final %.2f / %.2f %%\n",
+           BENCH_STEPS, maxDiff, PID_BENCH_TOLERANCE, speedFloat, speedQ16);
+    return maxDiff <= PID_BENCH_TOLERANCE;
+}
+
+// Feedback lấy từ bảng dựng sẵn để vòng đo chỉ còn lời gọi PID
+static float feedbackFloat[BENCH_STEPS];
+static q16_t feedbackQ16[BENCH_STEPS];
+static q16_t setpointQ16[BENCH_STEPS];
+
+static void buildInputs(void) {
+    float speed = 0.0f;
+    resetStates();
+    for (int step = 0; step < BENCH_STEPS; step++) {
+        feedbackFloat[step] = speed;
+        feedbackQ16[step] = (q16_t)(speed * Q16_ONE);
+        setpointQ16[step] = q16FromInt((int32_t)setpointAt(step));
+        speed = plantStep(speed, PID_Compute_float(1, setpointAt(step), speed));
+    }
+}
+
+static double benchFloat(void) {
+    uint64_t calls = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        resetStates();
+        for (int step = 0; step < BENCH_STEPS; step++) {
+            sinkFloat = PID_Compute_float(1, setpointAt(step), feedbackFloat[step]);
+        }
+        calls += BENCH_STEPS;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    return (double)elapsed / (double)calls;
+}
+
+static double benchQ16(void) {
+    uint64_t calls = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        resetStates();
+        for (int step = 0; step < BENCH_STEPS; step++) {
+            sinkQ16 = PID_Compute(1, setpointQ16[step], feedbackQ16[step]);
+        }
+        calls += BENCH_STEPS;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    return (double)elapsed / (double)calls;
+}
+
+// Cùng phần đo DWT như recordPIDCycles, không có PID
+static double benchDWTOverhead(void) {
+    uint64_t calls = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed;
+    do {
+        resetStates();
+        for (int step = 0; step < BENCH_STEPS; step++) {
+            uint32_t startCycles = DWT->CYCCNT;
+            sinkQ16 = setpointQ16[step];
+            uint32_t cycles = DWT->CYCCNT - startCycles;
+            HREG(REG_PID_CYCLES) = (cycles > 0xFFFF) ? 0xFFFF : cycles;
+            if (HREG(REG_PID_CYCLES) > HREG(REG_PID_CYCLES_MAX)) {
+                HREG(REG_PID_CYCLES_MAX) = HREG(REG_PID_CYCLES);
+            }
+            sinkCycles = cycles;
+        }
+        calls += BENCH_STEPS;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    return (double)elapsed / (double)calls;
+}
+
+// Xung nhịp host (MHz) từ /proc/cpuinfo - chỉ để quy ns ra cycle
+static double hostMHz(void) {
+    FILE *file = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    double mhz = 0.0;
+    if (file == NULL) {
+        return 0.0;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "cpu MHz : %lf", &mhz) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return mhz;
+}
+
+int main(int argc, char **argv) {
+    double mhz = 0.0;
+    if (argc > 2 && strcmp(argv[1], "-f") == 0) {
+        sscanf(argv[2], "%lf", &mhz);
+    } else {
+        mhz = hostMHz();
+    }
+
+    if (!verify()) {
+        return 1;
+    }
+    buildInputs();
+
+    // Chạy 1 vòng khởi động trước khi đo
+    benchFloat();
+    double floatNs = benchFloat();
+    double q16RawNs = benchQ16();
+    double overheadNs = benchDWTOverhead();
+    double q16Ns = q16RawNs - overheadNs;
+
+    printf("\n%-28s %10s %10s\n", "", "ns/call", "cycles");
+    printf("%-28s %10.1f %10.0f\n", "float PID_Compute", floatNs, floatNs * mhz / 1000.0);
+    printf("%-28s %10.1f %10.0f\n", "Q16 PID_Compute (+DWT)", q16RawNs, q16RawNs * mhz / 1000.0);
+    printf("%-28s %10.1f %10.0f\n", "  DWT read/record overhead", overheadNs, overheadNs * mhz / 1000.0);
+    printf("%-28s %10.1f %10.0f\n", "Q16 PID_Compute", q16Ns, q16Ns * mhz / 1000.0);
+    printf("\nspeedup %.2fx (host %.0f MHz, hardware FPU)\n", floatNs / q16Ns, mhz);
+    return 0;
+}